@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "tagged_ptr.h"
+
+template<typename _Ty> class atomic_shared_ptr;
+
+// An intrusive reference counted pointer, the value type of atomic_shared_ptr.
+template<typename _Ty> class counted_ptr
+{
+	template<typename> friend class atomic_shared_ptr;
+
+	class control_block
+	{
+		public:
+			template<typename... _Args> control_block(_Args&&... args)
+				: m_counter{ 1 }, m_data(std::forward<_Args>(args)...)
+			{
+			}
+
+			std::atomic<long> m_counter;
+			_Ty               m_data;
+	};
+
+	public:
+		counted_ptr() noexcept
+			: m_block{ nullptr }
+		{
+		}
+
+		counted_ptr(const counted_ptr& other) noexcept
+			: m_block{ other.m_block }
+		{
+			using namespace std;
+
+			if (this->m_block)
+			{
+				this->m_block->m_counter.fetch_add(1, memory_order_relaxed);
+			}
+		}
+
+		counted_ptr(counted_ptr&& other) noexcept
+			: m_block{ other.m_block }
+		{
+			other.m_block = nullptr;
+		}
+
+		~counted_ptr()
+		{
+			this->reset();
+		}
+
+		counted_ptr& operator=(counted_ptr other) noexcept
+		{
+			std::swap(this->m_block, other.m_block);
+			return *this;
+		}
+
+		template<typename... _Args> static counted_ptr make(_Args&&... args)
+		{
+			return counted_ptr(new control_block(std::forward<_Args>(args)...));
+		}
+
+		void reset()
+		{
+			if (this->m_block)
+			{
+				counted_ptr::add_ref(this->m_block, -1);
+				this->m_block = nullptr;
+			}
+		}
+
+		_Ty* get() const noexcept
+		{
+			return this->m_block ? &this->m_block->m_data : nullptr;
+		}
+
+		_Ty& operator*() const noexcept
+		{
+			return this->m_block->m_data;
+		}
+
+		_Ty* operator->() const noexcept
+		{
+			return &this->m_block->m_data;
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return this->m_block != nullptr;
+		}
+
+		bool operator==(const counted_ptr& other) const noexcept
+		{
+			return this->m_block == other.m_block;
+		}
+
+		bool operator!=(const counted_ptr& other) const noexcept
+		{
+			return this->m_block != other.m_block;
+		}
+
+	private:
+		explicit counted_ptr(control_block* block) noexcept
+			: m_block{ block }
+		{
+		}
+
+		control_block* detach() noexcept
+		{
+			control_block* const block = this->m_block;
+			this->m_block = nullptr;
+
+			return block;
+		}
+
+		static void add_ref(control_block* block, long count)
+		{
+			using namespace std;
+
+			if (count && block->m_counter.fetch_add(count, memory_order_acq_rel) == -count)
+			{
+				delete block;
+			}
+		}
+
+		control_block* m_block;
+};
+
+template<typename _Ty, typename... _Args> counted_ptr<_Ty> make_counted(_Args&&... args)
+{
+	return counted_ptr<_Ty>::make(std::forward<_Args>(args)...);
+}
+
+// A lock-free atomic counted_ptr built on split reference counts: the control block pointer shares
+// one word with a local counter of readers that have found the pointer but not yet taken a reference.
+// While the pointer is installed, its true count is the internal counter plus that local counter;
+// whoever swaps the pointer out folds the local counter into the internal one.
+template<typename _Ty> class atomic_shared_ptr
+{
+	using control_block = typename counted_ptr<_Ty>::control_block;
+	using word          = tagged_ptr<control_block>;
+
+	public:
+		static constexpr bool is_always_lock_free = std::atomic<word>::is_always_lock_free;
+
+		atomic_shared_ptr() noexcept
+			: m_ptr{ word() }
+		{
+		}
+
+		atomic_shared_ptr(counted_ptr<_Ty> desired) noexcept
+			: m_ptr{ word(desired.detach(), 0) }
+		{
+		}
+
+		~atomic_shared_ptr()
+		{
+			atomic_shared_ptr::release(this->m_ptr.load());
+		}
+
+		atomic_shared_ptr(const atomic_shared_ptr&) = delete;
+		atomic_shared_ptr& operator=(const atomic_shared_ptr&) = delete;
+
+		bool is_lock_free() const noexcept
+		{
+			return this->m_ptr.is_lock_free();
+		}
+
+		counted_ptr<_Ty> load() const
+		{
+			word current = this->m_ptr.load();
+			word borrowed;
+
+			for (;;)
+			{
+				if (!current.get_ptr())
+					return counted_ptr<_Ty>();
+
+				if (current.get_tag() == word::max_tag)
+				{
+					// the local counter is saturated, wait for the other readers to give their borrows back
+					std::this_thread::yield();
+					current = this->m_ptr.load();
+
+					continue;
+				}
+
+				borrowed = word(current.get_ptr(), current.get_tag() + 1);
+
+				if (this->m_ptr.compare_exchange_weak(current, borrowed))
+					break;
+			}
+
+			// the borrowed local count keeps the block alive until a reference of our own is taken
+			control_block* const block = borrowed.get_ptr();
+			counted_ptr<_Ty>::add_ref(block, 1);
+
+			current = borrowed;
+
+			while (current.get_ptr() == block && current.get_tag() > 0)
+			{
+				if (this->m_ptr.compare_exchange_weak(current, word(block, current.get_tag() - 1)))
+					return counted_ptr<_Ty>(block);
+			}
+
+			// the pointer was swapped out and the borrow was folded into the internal counter
+			counted_ptr<_Ty>::add_ref(block, -1);
+			return counted_ptr<_Ty>(block);
+		}
+
+		void store(counted_ptr<_Ty> desired)
+		{
+			atomic_shared_ptr::release(this->m_ptr.exchange(word(desired.detach(), 0)));
+		}
+
+		counted_ptr<_Ty> exchange(counted_ptr<_Ty> desired)
+		{
+			const word current = this->m_ptr.exchange(word(desired.detach(), 0));
+
+			if (current.get_ptr())
+			{
+				// the reference held by this object passes to the caller
+				counted_ptr<_Ty>::add_ref(current.get_ptr(), current.get_tag());
+			}
+
+			return counted_ptr<_Ty>(current.get_ptr());
+		}
+
+		bool compare_exchange_strong(counted_ptr<_Ty>& expected, counted_ptr<_Ty> desired)
+		{
+			word current = this->m_ptr.load();
+
+			while (current.get_ptr() == expected.m_block)
+			{
+				// a changed local counter alone fails the CAS, so it is retried until the pointer differs
+				if (this->m_ptr.compare_exchange_weak(current, word(desired.m_block, 0)))
+				{
+					desired.detach();
+					atomic_shared_ptr::release(current);
+
+					return true;
+				}
+			}
+
+			expected = this->load();
+			return false;
+		}
+
+		bool compare_exchange_weak(counted_ptr<_Ty>& expected, counted_ptr<_Ty> desired)
+		{
+			return this->compare_exchange_strong(expected, std::move(desired));
+		}
+
+	private:
+		static void release(word current)
+		{
+			if (current.get_ptr())
+			{
+				counted_ptr<_Ty>::add_ref(current.get_ptr(), static_cast<long>(current.get_tag()) - 1);
+			}
+		}
+
+		mutable std::atomic<word> m_ptr;
+};
+
+// Policies choosing how exp_stack_atomic_shared_ptr links its nodes.
+// Each provides the pointer type, the atomic pointer type and a factory.
+
+// std::shared_ptr with the atomic_load / atomic_compare_exchange free functions, which the standard
+// libraries implement with a table of spin locks
+class shared_ptr_free_functions
+{
+	public:
+		template<typename _Tx> using pointer = std::shared_ptr<_Tx>;
+
+		template<typename _Tx> class atomic_pointer
+		{
+			public:
+				static constexpr bool is_always_lock_free = false;
+
+				atomic_pointer() = default;
+				atomic_pointer(const atomic_pointer&) = delete;
+				atomic_pointer& operator=(const atomic_pointer&) = delete;
+
+				std::shared_ptr<_Tx> load() const
+				{
+					return std::atomic_load(&this->m_ptr);
+				}
+
+				void store(std::shared_ptr<_Tx> desired)
+				{
+					std::atomic_store(&this->m_ptr, std::move(desired));
+				}
+
+				bool compare_exchange_weak(std::shared_ptr<_Tx>& expected, std::shared_ptr<_Tx> desired)
+				{
+					return std::atomic_compare_exchange_weak(&this->m_ptr, &expected, std::move(desired));
+				}
+
+			private:
+				std::shared_ptr<_Tx> m_ptr;
+		};
+
+		template<typename _Tx, typename... _Args> static pointer<_Tx> make(_Args&&... args)
+		{
+			return std::make_shared<_Tx>(std::forward<_Args>(args)...);
+		}
+};
+
+// counted_ptr with the split reference count atomic_shared_ptr above
+class shared_ptr_split_count
+{
+	public:
+		template<typename _Tx> using pointer = counted_ptr<_Tx>;
+		template<typename _Tx> using atomic_pointer = atomic_shared_ptr<_Tx>;
+
+		template<typename _Tx, typename... _Args> static pointer<_Tx> make(_Args&&... args)
+		{
+			return make_counted<_Tx>(std::forward<_Args>(args)...);
+		}
+};
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+// C++20 std::atomic<std::shared_ptr>, lock-free or not depending on the standard library
+class shared_ptr_std_atomic
+{
+	public:
+		template<typename _Tx> using pointer = std::shared_ptr<_Tx>;
+		template<typename _Tx> using atomic_pointer = std::atomic<std::shared_ptr<_Tx>>;
+
+		template<typename _Tx, typename... _Args> static pointer<_Tx> make(_Args&&... args)
+		{
+			return std::make_shared<_Tx>(std::forward<_Args>(args)...);
+		}
+};
+#endif
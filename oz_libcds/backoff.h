@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64)
+#include <intrin.h>
+#endif
+
+// Backoff policies for CAS retry loops. A loop creates one policy object and calls it after every failed attempt,
+// so state such as the current delay lives for a single operation.
+
+// tells the core that this is a spin-wait loop: frees pipeline resources for the sibling hyperthread
+inline void cpu_relax()
+{
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	_mm_pause();
+#elif defined(_M_ARM) || defined(_M_ARM64)
+	__yield();
+#elif defined(__arm__) || defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// retries at once, the behaviour of the plain CAS loops
+class no_backoff
+{
+	public:
+		void operator()()
+		{
+		}
+};
+
+// one pause per failure
+class spin_backoff
+{
+	public:
+		void operator()()
+		{
+			cpu_relax();
+		}
+};
+
+// a random number of pauses below a limit that doubles with every failure, the jitter keeps
+// threads that failed together from retrying together
+template<unsigned int min_spins = 4, unsigned int max_spins = 1024> class exponential_backoff
+{
+	public:
+		exponential_backoff()
+			: m_limit{ min_spins }
+		{
+			static_assert(0 < min_spins && min_spins <= max_spins, "invalid spin limits");
+		}
+
+		void operator()()
+		{
+			thread_local static unsigned int seed = static_cast<unsigned int>(reinterpret_cast<std::size_t>(&seed)) | 1;
+
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+
+			const unsigned int spins = seed % this->m_limit + 1;
+
+			for (unsigned int i = 0; i < spins; i++)
+			{
+				cpu_relax();
+			}
+
+			if (this->m_limit < max_spins)
+			{
+				this->m_limit = this->m_limit * 2 < max_spins ? this->m_limit * 2 : max_spins;
+			}
+		}
+
+	private:
+		unsigned int m_limit;
+};
+
+// pauses for the first failures, then gives the core away so a preempted thread can finish its operation
+template<int spins_before_yield = 16> class yield_backoff
+{
+	public:
+		yield_backoff()
+			: m_failures{ 0 }
+		{
+		}
+
+		void operator()()
+		{
+			if (++this->m_failures <= spins_before_yield)
+			{
+				cpu_relax();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+		int m_failures;
+};
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+template<typename _Queue, typename _Ty> auto benchmark_pop(_Queue& queue, _Ty& value, int)
+	-> decltype(queue.try_pop(value))
+{
+	return queue.try_pop(value);
+}
+
+template<typename _Queue, typename _Ty> bool benchmark_pop(_Queue& queue, _Ty& value, long)
+{
+	using namespace std;
+
+	shared_ptr<_Ty> res = queue.pop();
+
+	if (res)
+	{
+		value = *res;
+		return true;
+	}
+
+	return false;
+}
+
+template<typename _Queue> double benchmark_queue(const char* name, _Queue& queue, int writers, int readers, long items_per_writer)
+{
+	using namespace std;
+
+	atomic<bool>      is_started{ false };
+	atomic<long>      items_left{ writers * items_per_writer };
+	atomic<long long> checksum{ 0 };
+
+	auto writer = [&]()->void
+	{
+		while (!is_started.load());
+
+		for (long i = 1; i <= items_per_writer; i++)
+		{
+			bool res = false;
+			queue.push(static_cast<int>(i), res);
+		}
+	};
+
+	auto reader = [&]()->void
+	{
+		while (!is_started.load());
+
+		long long sum = 0;
+
+		while (items_left.load(memory_order_relaxed) > 0)
+		{
+			int value = 0;
+
+			if (benchmark_pop(queue, value, 0))
+			{
+				sum += value;
+				items_left.fetch_sub(1, memory_order_relaxed);
+			}
+		}
+
+		checksum.fetch_add(sum);
+	};
+
+	vector<thread> threads;
+
+	for (int i = 0; i < writers; i++)
+	{
+		threads.push_back(thread(writer));
+	}
+
+	for (int i = 0; i < readers; i++)
+	{
+		threads.push_back(thread(reader));
+	}
+
+	const auto start = chrono::steady_clock::now();
+	is_started.store(true);
+
+	for (auto& th : threads)
+	{
+		th.join();
+	}
+
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	const long long n = items_per_writer;
+	const long long expected = writers * (n * (n + 1) / 2);
+	const double mops = writers * items_per_writer / elapsed.count() / 1e6;
+
+	printf("%-32s writers = %2i, readers = %2i: %8.2f Mops/s%s\n",
+		name, writers, readers, mops, checksum.load() == expected ? "" : " (checksum mismatch)");
+
+	return mops;
+}
+
+// runs benchmark_queue while a monitor samples the nodes the stack has retired but not freed yet
+template<typename _Stack> void benchmark_pending_nodes(const char* name, _Stack& stack, int writers, int readers, long items_per_writer)
+{
+	using namespace std;
+
+	atomic<bool> is_done{ false };
+	int peak = 0;
+
+	thread monitor([&]()->void
+	{
+		while (!is_done.load())
+		{
+			peak = max(peak, stack.pending_nodes());
+			this_thread::yield();
+		}
+	});
+
+	benchmark_queue(name, stack, writers, readers, items_per_writer);
+
+	is_done.store(true);
+	monitor.join();
+
+	printf("%-32s peak pending nodes = %i, final = %i, max_pending_nodes = %i\n",
+		name, max(peak, stack.pending_nodes()), stack.pending_nodes(), _Stack::pending_nodes_limit);
+}
+
+template<typename _Queue> double benchmark_queue_bulk(const char* name, _Queue& queue, int writers, int readers, long items_per_writer, int batch_size)
+{
+	using namespace std;
+
+	atomic<bool>      is_started{ false };
+	atomic<long>      items_left{ writers * items_per_writer };
+	atomic<long long> checksum{ 0 };
+
+	auto writer = [&]()->void
+	{
+		while (!is_started.load());
+
+		vector<int> batch;
+		batch.reserve(batch_size);
+
+		for (long i = 1; i <= items_per_writer; i++)
+		{
+			batch.push_back(static_cast<int>(i));
+
+			if (batch.size() == static_cast<size_t>(batch_size) || i == items_per_writer)
+			{
+				queue.push_range(batch.begin(), batch.end());
+				batch.clear();
+			}
+		}
+	};
+
+	auto reader = [&]()->void
+	{
+		while (!is_started.load());
+
+		long long sum = 0;
+		vector<int> batch(batch_size);
+
+		while (items_left.load(memory_order_relaxed) > 0)
+		{
+			const int j = queue.pop_bulk(batch.begin(), batch_size);
+
+			for (int i = 0; i < j; i++)
+			{
+				sum += batch[i];
+			}
+
+			items_left.fetch_sub(j, memory_order_relaxed);
+		}
+
+		checksum.fetch_add(sum);
+	};
+
+	vector<thread> threads;
+
+	for (int i = 0; i < writers; i++)
+	{
+		threads.push_back(thread(writer));
+	}
+
+	for (int i = 0; i < readers; i++)
+	{
+		threads.push_back(thread(reader));
+	}
+
+	const auto start = chrono::steady_clock::now();
+	is_started.store(true);
+
+	for (auto& th : threads)
+	{
+		th.join();
+	}
+
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	const long long n = items_per_writer;
+	const long long expected = writers * (n * (n + 1) / 2);
+	const double mops = writers * items_per_writer / elapsed.count() / 1e6;
+
+	printf("%-32s writers = %2i, readers = %2i, batch = %4i: %8.2f Mops/s%s\n",
+		name, writers, readers, batch_size, mops, checksum.load() == expected ? "" : " (checksum mismatch)");
+
+	return mops;
+}
+
+template<typename _Queue> void benchmark_queue_latency(const char* name, _Queue& queue, int threads, long ops_per_thread)
+{
+	using namespace std;
+
+	atomic<bool> is_started{ false };
+	vector<vector<long long>> samples(threads);
+
+	auto worker = [&](int index)->void
+	{
+		vector<long long>& latencies = samples[index];
+		latencies.reserve(2 * ops_per_thread);
+
+		while (!is_started.load());
+
+		for (long i = 1; i <= ops_per_thread; i++)
+		{
+			bool res = false;
+			int value = 0;
+
+			auto start = chrono::steady_clock::now();
+			queue.push(static_cast<int>(i), res);
+			auto end = chrono::steady_clock::now();
+
+			latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+
+			start = chrono::steady_clock::now();
+			benchmark_pop(queue, value, 0);
+			end = chrono::steady_clock::now();
+
+			latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+		}
+	};
+
+	vector<thread> workers;
+
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(thread(worker, i));
+	}
+
+	is_started.store(true);
+
+	for (auto& th : workers)
+	{
+		th.join();
+	}
+
+	vector<long long> latencies;
+
+	for (auto& item : samples)
+	{
+		latencies.insert(latencies.end(), item.begin(), item.end());
+	}
+
+	sort(latencies.begin(), latencies.end());
+
+	auto percentile = [&](double p)->long long
+	{
+		const size_t i = static_cast<size_t>(p * (latencies.size() - 1));
+		return latencies[i];
+	};
+
+	printf("%-32s threads = %3i: p50 = %6lld ns, p99 = %8lld ns, p99.99 = %10lld ns, max = %10lld ns\n",
+		name, threads, percentile(0.5), percentile(0.99), percentile(0.9999), latencies.back());
+}
+
+// Fills the map with keys [0, keys) from all threads, then runs a mix of lookups and writes on random keys.
+// A key always maps to itself, so every hit can be checked.
+template<typename _Map> double benchmark_map(const char* name, _Map& map, int threads_count, int keys, int read_percent, long ops_per_thread)
+{
+	using namespace std;
+
+	atomic<bool> is_started{ false };
+	atomic<bool> is_filled{ false };
+	atomic<int>  threads_filling{ threads_count };
+	atomic<long> mismatches{ 0 };
+
+	chrono::steady_clock::time_point filled;
+
+	auto worker = [&](int index)->void
+	{
+		while (!is_started.load());
+
+		for (int key = index; key < keys; key += threads_count)
+		{
+			map.add_or_update(key, key);
+		}
+
+		if (threads_filling.fetch_sub(1) == 1)
+		{
+			filled = chrono::steady_clock::now();
+			is_filled.store(true);
+		}
+
+		while (!is_filled.load());
+
+		unsigned int seed = 2463534242u + static_cast<unsigned int>(index) * 7919u;
+		long bad = 0;
+
+		for (long i = 0; i < ops_per_thread; i++)
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+
+			const int key = static_cast<int>(seed % static_cast<unsigned int>(keys));
+
+			if (static_cast<int>((seed >> 8) % 100) < read_percent)
+			{
+				int value = -1;
+
+				if (map.get_value(key, value) && value != key)
+				{
+					++bad;
+				}
+			}
+			else if (seed & 1)
+			{
+				map.remove(key);
+			}
+			else
+			{
+				map.add_or_update(key, key);
+			}
+		}
+
+		mismatches.fetch_add(bad);
+	};
+
+	vector<thread> threads;
+
+	for (int i = 0; i < threads_count; i++)
+	{
+		threads.push_back(thread(worker, i));
+	}
+
+	const auto start = chrono::steady_clock::now();
+	is_started.store(true);
+
+	for (auto& th : threads)
+	{
+		th.join();
+	}
+
+	const auto finish = chrono::steady_clock::now();
+
+	const chrono::duration<double> fill_elapsed = filled - start;
+	const chrono::duration<double> mix_elapsed  = finish - filled;
+
+	const double fill_mops = keys / fill_elapsed.count() / 1e6;
+	const double mix_mops  = threads_count * ops_per_thread / mix_elapsed.count() / 1e6;
+
+	printf("%-32s threads = %2i, keys = %8i, reads = %3i%%: fill %8.2f Mops/s, mix %8.2f Mops/s%s\n",
+		name, threads_count, keys, read_percent, fill_mops, mix_mops, mismatches.load() ? " (value mismatch)" : "");
+
+	return mix_mops;
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+#include <cstddef>
+
+#include "backoff.h"
+
+// BRAVO (Dice, Kogan): a reader-biased wrapper around a reader-writer lock. While the bias is on, a reader only
+// publishes itself in a slot of a visible-readers table shared by all locks, picked by hashing the thread and the lock,
+// so the readers of a hot lock write to different cache lines instead of one reader count.
+// A writer takes the underlying lock, turns the bias off and waits until no slot holds its lock. The bias comes back
+// once a multiple of the time the revocation took has passed, so write-heavy phases do not pay for it over and over.
+// Satisfies the SharedMutex requirements, but must be unlocked by the thread that locked it.
+template<typename _Lock = std::shared_mutex> class bravo_shared_mutex
+{
+	static constexpr std::size_t table_size         = 1024;
+	static constexpr int         inhibit_multiplier = 9;
+	static constexpr int         max_fast_reads     = 8;
+
+	using slot = std::atomic<const bravo_shared_mutex*>;
+	using clock = std::chrono::steady_clock;
+
+	// the fast read locks the thread holds, unlock_shared has nothing else to tell them from slow ones
+	class fast_reads
+	{
+		public:
+			fast_reads()
+				: m_count{ 0 }
+			{
+			}
+
+			bool is_full() const
+			{
+				return this->m_count == max_fast_reads;
+			}
+
+			void add(const bravo_shared_mutex* lock, slot* item)
+			{
+				this->m_locks[this->m_count] = lock;
+				this->m_slots[this->m_count] = item;
+
+				++this->m_count;
+			}
+
+			slot* remove(const bravo_shared_mutex* lock)
+			{
+				for (int i = this->m_count - 1; i >= 0; i--)
+				{
+					if (this->m_locks[i] == lock)
+					{
+						slot* const item = this->m_slots[i];
+
+						--this->m_count;
+						this->m_locks[i] = this->m_locks[this->m_count];
+						this->m_slots[i] = this->m_slots[this->m_count];
+
+						return item;
+					}
+				}
+
+				return nullptr;
+			}
+
+		private:
+			const bravo_shared_mutex* m_locks[max_fast_reads];
+			slot*                     m_slots[max_fast_reads];
+			int                       m_count;
+	};
+
+	public:
+		bravo_shared_mutex()
+			: m_reader_bias{ true }, m_inhibit_until{ 0 }
+		{
+		}
+
+		bravo_shared_mutex(const bravo_shared_mutex&) = delete;
+		bravo_shared_mutex& operator=(const bravo_shared_mutex&) = delete;
+
+		void lock()
+		{
+			this->m_lock.lock();
+
+			if (this->m_reader_bias.load())
+			{
+				this->revoke_bias();
+			}
+		}
+
+		bool try_lock()
+		{
+			if (!this->m_lock.try_lock())
+				return false;
+
+			if (this->m_reader_bias.load())
+			{
+				this->revoke_bias();
+			}
+
+			return true;
+		}
+
+		void unlock()
+		{
+			this->m_lock.unlock();
+		}
+
+		void lock_shared()
+		{
+			if (this->try_lock_shared_fast())
+				return;
+
+			this->m_lock.lock_shared();
+			this->restore_bias();
+		}
+
+		bool try_lock_shared()
+		{
+			if (this->try_lock_shared_fast())
+				return true;
+
+			if (!this->m_lock.try_lock_shared())
+				return false;
+
+			this->restore_bias();
+			return true;
+		}
+
+		void unlock_shared()
+		{
+			using namespace std;
+
+			if (slot* const item = bravo_shared_mutex::get_fast_reads().remove(this))
+			{
+				item->store(nullptr, memory_order_release);
+				return;
+			}
+
+			this->m_lock.unlock_shared();
+		}
+
+	private:
+		// the slot is taken before the bias is checked and the writer clears the bias before it scans the slots,
+		// both sequentially consistent, so either the reader sees the bias gone or the writer sees the reader
+		bool try_lock_shared_fast()
+		{
+			if (!this->m_reader_bias.load())
+				return false;
+
+			fast_reads& reads = bravo_shared_mutex::get_fast_reads();
+
+			if (reads.is_full())
+				return false;
+
+			slot& item = bravo_shared_mutex::get_table()[this->get_slot_index()];
+			const bravo_shared_mutex* empty = nullptr;
+
+			if (!item.compare_exchange_strong(empty, this))
+				return false;
+
+			if (!this->m_reader_bias.load())
+			{
+				item.store(nullptr);
+				return false;
+			}
+
+			reads.add(this, &item);
+			return true;
+		}
+
+		// called under the underlying write lock, so no slow reader can turn the bias back on meanwhile
+		void revoke_bias()
+		{
+			using namespace std;
+
+			this->m_reader_bias.store(false);
+
+			const clock::time_point start = clock::now();
+			slot* const table = bravo_shared_mutex::get_table();
+
+			// a reader may be preempted while it holds its slot, so the wait ends up yielding
+			yield_backoff<> backoff;
+
+			for (size_t i = 0; i < table_size; i++)
+			{
+				while (table[i].load() == this)
+				{
+					backoff();
+				}
+			}
+
+			const clock::time_point end = clock::now();
+			this->m_inhibit_until.store((end + inhibit_multiplier * (end - start)).time_since_epoch().count(), memory_order_relaxed);
+		}
+
+		// called under the underlying read lock, so no writer is revoking meanwhile
+		void restore_bias()
+		{
+			using namespace std;
+
+			if (!this->m_reader_bias.load(memory_order_relaxed) &&
+				clock::now().time_since_epoch().count() >= this->m_inhibit_until.load(memory_order_relaxed))
+			{
+				this->m_reader_bias.store(true);
+			}
+		}
+
+		std::size_t get_slot_index() const
+		{
+			thread_local static char token;
+
+			std::size_t hash = reinterpret_cast<std::size_t>(&token) ^ (reinterpret_cast<std::size_t>(this) >> 4);
+
+			hash ^= hash >> 16;
+			hash *= static_cast<std::size_t>(0x45d9f3bu);
+			hash ^= hash >> 16;
+
+			return hash % table_size;
+		}
+
+		static fast_reads& get_fast_reads()
+		{
+			thread_local static fast_reads reads;
+			return reads;
+		}
+
+		// shared by every lock of this type, the slots say which lock a reader holds
+		static slot* get_table()
+		{
+			static slot table[table_size];
+			return table;
+		}
+
+		_Lock                             m_lock;
+		std::atomic<bool>                 m_reader_bias;
+		std::atomic<clock::duration::rep> m_inhibit_until;
+};
@@ -3,121 +3,180 @@
 #include <utility>
 #include <memory>
 #include <algorithm>
-#include <list>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <shared_mutex>
 #include <atomic>
+#include <cstddef>
 
-template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>, int num_of_buckets = 17> class concurrent_map
+#include "map_storage.h"
+#include "backoff.h"
+
+// The map is split into num_of_shards lock stripes, each with its own reader-writer lock and its own hash table.
+// The lock type is a policy as well: std::shared_mutex, or bravo_shared_mutex for read-mostly maps.
+// The tables come from the _Storage policy (map_storage.h) and resize incrementally, so readers keep working
+// while a table grows. With flat_storage and trivially copyable keys and values, lookups first try to read
+// without the lock and validate the copy against the shard's version.
+template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>, int num_of_shards = 17, typename _Storage = chained_storage, typename _Lock = std::shared_mutex> class concurrent_map
 {
-	class bucket
+	using table = typename _Storage::template table<_Key, _Val, _Hash>;
+
+	static constexpr int optimistic_attempts = 4;
+
+	// keeps the shard's version odd while a writer changes the table, only tables that allow optimistic reads need it
+	class write_section
 	{
 		public:
-			using data_item = std::pair<_Key, _Val>;
-			using container = std::list<data_item>;
-		
-			decltype(auto) find_entry(const _Key& key)
+			write_section(std::atomic<unsigned int>& version)
+				: m_version{ version }
 			{
 				using namespace std;
 
-				return find_if(this->m_data.begin(), this->m_data.end(),
-					[&](const data_item& item)->bool { return item.first == key; });
+				if constexpr (table::optimistic_reads)
+				{
+					this->m_version.store(this->m_version.load(memory_order_relaxed) + 1, memory_order_relaxed);
+					atomic_thread_fence(memory_order_release);
+				}
 			}
 
-			decltype(auto) find_entry(const _Key& key) const
+			~write_section()
 			{
 				using namespace std;
 
-				return find_if(this->m_data.cbegin(), this->m_data.cend(),
-					[&](const data_item& item)->bool { return item.first == key; });
+				if constexpr (table::optimistic_reads)
+				{
+					this->m_version.store(this->m_version.load(memory_order_relaxed) + 1, memory_order_release);
+				}
 			}
 
-			_Val get_value(const _Key& key, const _Val& default_value) const
+			write_section(const write_section&) = delete;
+			write_section& operator=(const write_section&) = delete;
+
+		private:
+			std::atomic<unsigned int>& m_version;
+	};
+
+	class shard
+	{
+		public:
+			shard(const _Hash& hasher)
+				: m_table{ hasher }, m_version{ 0 }
 			{
-				using namespace std;
+			}
 
-				shared_lock<shared_mutex> lock(this->m_mutex);
-				auto entry = this->find_entry(key);
+			_Val get_value(const _Key& key, std::size_t hash, const _Val& default_value) const
+			{
+				_Val res = default_value;
+				this->get_value(key, hash, res);
 
-				return entry == this->m_data.end()
-					? default_value : entry->second;
+				return res;
 			}
 
-			bool get_value(const _Key& key, _Val& value) const
+			bool get_value(const _Key& key, std::size_t hash, _Val& value) const
 			{
 				using namespace std;
 
-				shared_lock<shared_mutex> lock(this->m_mutex);
-				auto entry = this->find_entry(key);
+				bool res = false;
+
+				if (this->try_get_value_optimistic(key, hash, value, res))
+				{
+					return res;
+				}
+
+				shared_lock<_Lock> lock(this->m_mutex);
+				const _Val* const entry = this->m_table.find(key, hash);
 
-				if (entry == this->m_data.end())
+				if (!entry)
 				{
 					return false;
 				}
 
-				value = entry->second;
+				value = *entry;
 				return true;
 			}
 
-			bool add_or_update(const _Key& key, const _Val& value)
+			bool add_or_update(const _Key& key, std::size_t hash, const _Val& value)
 			{
 				using namespace std;
 
-				unique_lock<shared_mutex> lock(this->m_mutex);
-				auto entry = this->find_entry(key);
+				unique_lock<_Lock> lock(this->m_mutex);
+				const write_section section(this->m_version);
 
-				if (entry == this->m_data.end())
-				{
-					this->m_data.push_back(data_item(key, value));
-					return true;
-				}
-				else
-				{
-					entry->second = value;
-					return false;
-				}
+				return this->m_table.insert_or_assign(key, hash, value);
 			}
 
-			bool remove(const _Key& key)
+			bool remove(const _Key& key, std::size_t hash)
 			{
 				using namespace std;
 
-				unique_lock<shared_mutex> lock(this->m_mutex);
-				auto entry = this->find_entry(key);
-
-				if (entry == this->m_data.end())
-					return false;
+				unique_lock<_Lock> lock(this->m_mutex);
+				const write_section section(this->m_version);
 
-				this->m_data.erase(entry);
-				return true;
+				return this->m_table.erase(key, hash);
 			}
 
 			int clear()
 			{
 				using namespace std;
 
-				unique_lock<shared_mutex> lock(this->m_mutex);
-
-				int res = this->m_data.size();
-				this->m_data.clear();
+				unique_lock<_Lock> lock(this->m_mutex);
+				const write_section section(this->m_version);
 
-				return res;
+				return this->m_table.clear();
 			}
 
-			container m_data;
-			mutable std::shared_mutex m_mutex;
+			table m_table;
+			mutable _Lock m_mutex;
+			std::atomic<unsigned int> m_version;
+
+		private:
+			// a seqlock read: the version is odd while a writer is inside, so a copy taken between two equal even
+			// versions is consistent. Gives up after a few collisions and leaves the read to the shared lock
+			bool try_get_value_optimistic(const _Key& key, std::size_t hash, _Val& value, bool& res) const
+			{
+				using namespace std;
+
+				if constexpr (table::optimistic_reads)
+				{
+					for (int i = 0; i < optimistic_attempts; i++)
+					{
+						const unsigned int version = this->m_version.load(memory_order_acquire);
+
+						if (version & 1)
+						{
+							cpu_relax();
+							continue;
+						}
+
+						const _Val* const entry = this->m_table.find(key, hash);
+						const _Val data = entry ? *entry : value;
+
+						atomic_thread_fence(memory_order_acquire);
+
+						if (this->m_version.load(memory_order_relaxed) == version)
+						{
+							value = data;
+							res = entry != nullptr;
+
+							return true;
+						}
+					}
+				}
+
+				return false;
+			}
 	};
 
 	public:
-		concurrent_map(const _Hash& hasher = _Hash()) 
+		concurrent_map(const _Hash& hasher = _Hash())
 			: m_hasher{ hasher }
 		{
 			using namespace std;
 
-			for (int i = 0; i < num_of_buckets; i++)
+			for (int i = 0; i < num_of_shards; i++)
 			{
-				this->m_buckets[i] = move(make_unique<bucket>());
+				this->m_shards[i] = make_unique<shard>(this->m_hasher);
 			}
 		}
 
@@ -125,9 +184,9 @@ template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>, int num
 		{
 			using namespace std;
 
-			for (int i = 0; i < num_of_buckets; i++)
+			for (int i = 0; i < num_of_shards; i++)
 			{
-				unique_ptr<bucket> ptr = move(this->m_buckets[i]);
+				unique_ptr<shard> ptr = move(this->m_shards[i]);
 			}
 		}
 
@@ -136,22 +195,26 @@ template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>, int num
 
 		_Val get_value(const _Key& key, const _Val& default_value = _Val()) const
 		{
-			return this->get_bucket(key).get_value(key, default_value);
+			const std::size_t hash = this->m_hasher(key);
+			return this->get_shard(hash).get_value(key, hash, default_value);
 		}
 
 		bool get_value(const _Key& key, _Val& value) const
 		{
-			return this->get_bucket(key).get_value(key, value);
+			const std::size_t hash = this->m_hasher(key);
+			return this->get_shard(hash).get_value(key, hash, value);
 		}
 
 		bool add_or_update(const _Key& key, const _Val& value)
 		{
-			return this->get_bucket(key).add_or_update(key, value);
+			const std::size_t hash = this->m_hasher(key);
+			return this->get_shard(hash).add_or_update(key, hash, value);
 		}
 
 		bool remove(const _Key& key)
 		{
-			return this->get_bucket(key).remove(key);
+			const std::size_t hash = this->m_hasher(key);
+			return this->get_shard(hash).remove(key, hash);
 		}
 
 		std::map<_Key, _Val> get_map() const
@@ -159,47 +222,40 @@ template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>, int num
 			using namespace std;
 
 			map<_Key, _Val> res;
-			vector<shared_lock<shared_mutex>> locks(num_of_buckets);
+			vector<shared_lock<_Lock>> locks;
+			locks.reserve(num_of_shards);
 
-			for (int i = 0; i < num_of_buckets; i++)
+			for (int i = 0; i < num_of_shards; i++)
 			{
-				locks.push_back(shared_lock<shared_mutex>(this->m_buckets[i]->m_mutex));
+				locks.push_back(shared_lock<_Lock>(this->m_shards[i]->m_mutex));
 			}
 
-			for (int i = 0; i < num_of_buckets; i++)
+			for (int i = 0; i < num_of_shards; i++)
 			{
-				auto it     = this->m_buckets[i]->m_data.begin();
-				auto it_end = this->m_buckets[i]->m_data.end();
-
-				while (it != it_end)
-				{
-					res.insert(*it);
-					++it;
-				}
+				this->m_shards[i]->m_table.for_each([&](const pair<_Key, _Val>& item)->void { res.insert(item); });
 			}
 
-			return move(res);
+			return res;
 		}
 
 		int clear()
 		{
 			int res = 0;
 
-			for (int i = 0; i < num_of_buckets; i++)
+			for (int i = 0; i < num_of_shards; i++)
 			{
-				res += this->m_buckets[i]->clear();
+				res += this->m_shards[i]->clear();
 			}
 
 			return res;
 		}
 
 	private:
-		bucket& get_bucket(const _Key& key) const
+		shard& get_shard(std::size_t hash) const
 		{
-			const int j = this->m_hasher(key) % num_of_buckets;
-			return *this->m_buckets[j];
+			return *this->m_shards[hash % num_of_shards];
 		}
-		
-		std::unique_ptr<bucket> m_buckets[num_of_buckets];
+
+		std::unique_ptr<shard> m_shards[num_of_shards];
 		_Hash m_hasher;
 };
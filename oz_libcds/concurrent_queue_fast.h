@@ -3,6 +3,7 @@
 #include <initializer_list>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
@@ -12,12 +13,12 @@ template <typename _Ty> class concurrent_queue_fast
 	class node
 	{
 		public:
-			node() : m_next{ nullptr }, m_data_ptr{ nullptr }
+			node() : m_next{ nullptr }
 			{
 			}
 
 			node* m_next;
-			std::shared_ptr<_Ty> m_data_ptr;
+			std::optional<_Ty> m_data;
 	};
 
 	std::unique_lock<std::mutex> lock_tail() const
@@ -39,9 +40,29 @@ template <typename _Ty> class concurrent_queue_fast
 	node* get_tail() const
 	{
 		using namespace std;
-		
-		unique_lock<mutex> lock(this->lock_tail());
-		return this->m_tail;
+
+		return this->m_tail.load(memory_order_acquire);
+	}
+
+	void notify_waiters(bool notify_all)
+	{
+		using namespace std;
+
+		if (!this->m_waiters.load())
+			return;
+
+		{
+			lock_guard<mutex> lock(this->m_head_mutex);
+		}
+
+		if (notify_all)
+		{
+			this->m_cv.notify_all();
+		}
+		else
+		{
+			this->m_cv.notify_one();
+		}
 	}
 
 	std::unique_ptr<node> pop_head()
@@ -73,7 +94,10 @@ template <typename _Ty> class concurrent_queue_fast
 		using namespace std;
 
 		unique_lock<mutex> lock(this->lock_head());
-		this->m_cv.wait(lock, [&]()->bool { return !m_is_active || m_head != get_tail(); });
+
+		this->m_waiters.fetch_add(1);
+		this->m_cv.wait(lock, [&]()->bool { return !m_is_active || m_head != m_tail.load(); });
+		this->m_waiters.fetch_sub(1);
 
 		return move(lock);
 	}
@@ -94,7 +118,7 @@ template <typename _Ty> class concurrent_queue_fast
 
 	public:
 		concurrent_queue_fast()
-			: m_is_active{ true }, m_head{ new node }, m_tail{ m_head }
+			: m_is_active{ true }, m_head{ new node }, m_tail{ m_head }, m_waiters{ 0 }
 		{
 		}
 
@@ -187,7 +211,7 @@ template <typename _Ty> class concurrent_queue_fast
 					this_node->m_next = temp;
 				}
 
-				this_node->m_data_ptr = make_shared<_Ty>(*other_node->m_data_ptr);
+				this_node->m_data = *other_node->m_data;
 				other_node = other_node->m_next;
 			}
 
@@ -222,7 +246,7 @@ template <typename _Ty> class concurrent_queue_fast
 			node* temp = this->m_head;
 
 			this->m_head = other.m_head;
-			this->m_tail = other.m_tail;
+			this->m_tail = other.m_tail.load();
 
 			other.m_head = temp;
 			other.m_tail = temp;
@@ -238,24 +262,105 @@ template <typename _Ty> class concurrent_queue_fast
 				return;
 			}
 
-			shared_ptr<_Ty>  data_ptr(make_shared<_Ty>(move(item)));
 			unique_ptr<node> node_ptr(make_unique<node>());
 
 			unique_lock<mutex> lock(this->lock_tail());
 
-			this->m_tail->m_data_ptr = move(data_ptr);
-			this->m_tail->m_next = node_ptr.get();
-			this->m_tail = node_ptr.get();
+			node* const tail = this->m_tail.load(memory_order_relaxed);
+
+			tail->m_data.emplace(move(item));
+			tail->m_next = node_ptr.get();
+			this->m_tail.store(node_ptr.get());
 
 			node_ptr.release();
 			
 			lock.unlock();
 			lock.release();
 
-			this->m_cv.notify_one();
+			this->notify_waiters(false);
 			res = true;
 		}
 
+		template<typename _InputIt> int push_range(_InputIt first, _InputIt last)
+		{
+			using namespace std;
+
+			if (!this->m_is_active || first == last)
+				return 0;
+
+			int j = 1;
+
+			_Ty              data(*first);
+			unique_ptr<node> node_ptr(make_unique<node>());
+
+			node* chain_tail = node_ptr.get();
+
+			while (++first != last)
+			{
+				node* const item = new node;
+
+				chain_tail->m_data.emplace(*first);
+				chain_tail->m_next = item;
+				chain_tail = item;
+
+				++j;
+			}
+
+			unique_lock<mutex> lock(this->lock_tail());
+
+			node* const tail = this->m_tail.load(memory_order_relaxed);
+
+			tail->m_data.emplace(move(data));
+			tail->m_next = node_ptr.get();
+			this->m_tail.store(chain_tail);
+
+			node_ptr.release();
+
+			lock.unlock();
+			lock.release();
+
+			this->notify_waiters(j > 1);
+
+			return j;
+		}
+
+		template<typename _OutputIt> int pop_bulk(_OutputIt out_it, int max_items)
+		{
+			using namespace std;
+
+			unique_lock<mutex> lock(this->lock_head());
+
+			if (!this->m_is_active || max_items <= 0)
+				return 0;
+
+			node* const tail = this->get_tail();
+			node* const first = this->m_head;
+
+			int j = 0;
+
+			while (j < max_items && this->m_head != tail)
+			{
+				this->m_head = this->m_head->m_next;
+				++j;
+			}
+
+			lock.unlock();
+			lock.release();
+
+			node* item = first;
+
+			for (int i = 0; i < j; i++)
+			{
+				unique_ptr<node> const temp(item);
+				item = item->m_next;
+
+				*out_it = move(*temp->m_data);
+				++out_it;
+			}
+
+			return j;
+		}
+
 		std::shared_ptr<_Ty> try_pop()
 		{
 			using namespace std;
@@ -264,7 +369,7 @@ template <typename _Ty> class concurrent_queue_fast
 
 			if (head)
 			{
-				return move(head->m_data_ptr);
+				return make_shared<_Ty>(move(*head->m_data));
 			}
 
 			return shared_ptr<_Ty>();
@@ -278,7 +383,7 @@ template <typename _Ty> class concurrent_queue_fast
 
 			if (head)
 			{
-				res = move(*head->m_data_ptr);
+				res = move(*head->m_data);
 				return true;
 			}
 
@@ -293,7 +398,7 @@ template <typename _Ty> class concurrent_queue_fast
 			
 			if (head)
 			{
-				return move(head->m_data_ptr);
+				return make_shared<_Ty>(move(*head->m_data));
 			}
 
 			return shared_ptr<_Ty>();
@@ -307,7 +412,7 @@ template <typename _Ty> class concurrent_queue_fast
 
 			if (head)
 			{
-				res = move(*head->m_data_ptr);
+				res = move(*head->m_data);
 				return true;
 			}
 
@@ -339,7 +444,7 @@ template <typename _Ty> class concurrent_queue_fast
 			this->m_head = other.m_head;
 			other.m_head = this_head;
 
-			this->m_tail = other.m_tail;
+			this->m_tail = other.m_tail.load();
 			other.m_tail = this_tail;
 		}
 
@@ -370,7 +475,7 @@ template <typename _Ty> class concurrent_queue_fast
 
 			while (item != this->get_tail())
 			{
-				cout << *item->m_data_ptr << endl;
+				cout << *item->m_data << endl;
 				item = item->m_next;
 			}
 		}
@@ -379,7 +484,8 @@ template <typename _Ty> class concurrent_queue_fast
 		mutable std::mutex      m_head_mutex;
 		mutable std::mutex      m_tail_mutex;
 		node*				    m_head;
-		node*                   m_tail;
+		std::atomic<node*>      m_tail;
 		std::condition_variable m_cv;
 		std::atomic<bool>       m_is_active;
+		std::atomic<int>        m_waiters;
 };
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+template <typename _Ty, int segment_size = 64> class concurrent_queue_segmented
+{
+	class segment
+	{
+		public:
+			segment() : m_begin{ 0 }, m_end{ 0 }, m_next{ nullptr }
+			{
+			}
+
+			~segment()
+			{
+				const int end = this->m_end.load();
+
+				for (int i = this->m_begin; i < end; i++)
+				{
+					this->get_data(i)->~_Ty();
+				}
+			}
+
+			segment(const segment&) = delete;
+			segment& operator=(const segment&) = delete;
+
+			_Ty* get_data(int i)
+			{
+				return reinterpret_cast<_Ty*>(this->m_storage) + i;
+			}
+
+			int                   m_begin;
+			std::atomic<int>      m_end;
+			std::atomic<segment*> m_next;
+
+			alignas(_Ty) unsigned char m_storage[segment_size * sizeof(_Ty)];
+	};
+
+	std::unique_lock<std::mutex> lock_tail() const
+	{
+		using namespace std;
+
+		unique_lock<mutex> lock(this->m_tail_mutex);
+		return lock;
+	}
+
+	std::unique_lock<std::mutex> lock_head() const
+	{
+		using namespace std;
+
+		unique_lock<mutex> lock(this->m_head_mutex);
+		return lock;
+	}
+
+	bool has_data() const
+	{
+		const segment* const head = this->m_head;
+
+		if (head->m_begin < head->m_end.load())
+			return true;
+
+		if (head->m_begin < segment_size)
+			return false;
+
+		const segment* const next = head->m_next.load();
+		return next && next->m_end.load() > 0;
+	}
+
+	bool pop_item(_Ty& res)
+	{
+		using namespace std;
+
+		segment* head = this->m_head;
+
+		if (head->m_begin == segment_size)
+		{
+			segment* const next = head->m_next.load();
+
+			if (!next)
+				return false;
+
+			this->m_head = next;
+			delete head;
+			head = next;
+		}
+
+		if (head->m_begin == head->m_end.load())
+			return false;
+
+		_Ty* const data = head->get_data(head->m_begin);
+
+		res = move(*data);
+		data->~_Ty();
+
+		++head->m_begin;
+
+		return true;
+	}
+
+	void notify_waiters()
+	{
+		using namespace std;
+
+		if (!this->m_waiters.load())
+			return;
+
+		{
+			lock_guard<mutex> lock(this->m_head_mutex);
+		}
+
+		this->m_cv.notify_one();
+	}
+
+	int delete_segments()
+	{
+		int j = 0;
+		segment* item = this->m_head;
+
+		while (item)
+		{
+			segment* const next = item->m_next.load();
+
+			j += item->m_end.load() - item->m_begin;
+			delete item;
+
+			item = next;
+		}
+
+		this->m_head = this->m_tail = nullptr;
+
+		return j;
+	}
+
+	public:
+		concurrent_queue_segmented()
+			: m_head{ new segment }, m_tail{ m_head }, m_is_active{ true }, m_waiters{ 0 }
+		{
+			static_assert(segment_size > 0, "segment_size must be positive");
+		}
+
+		concurrent_queue_segmented(std::initializer_list<_Ty>& init_list)
+			: concurrent_queue_segmented()
+		{
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				bool res = false;
+				this->push(*it, res);
+
+				++it;
+			}
+		}
+
+		~concurrent_queue_segmented()
+		{
+			using namespace std;
+
+			this->m_is_active = false;
+			this->m_cv.notify_all();
+
+			scoped_lock s_lock(this->m_head_mutex, this->m_tail_mutex);
+			this->delete_segments();
+		}
+
+		concurrent_queue_segmented(const concurrent_queue_segmented&) = delete;
+		concurrent_queue_segmented& operator=(const concurrent_queue_segmented&) = delete;
+
+		void push(_Ty item, bool& res)
+		{
+			using namespace std;
+
+			if (!this->m_is_active)
+			{
+				res = false;
+				return;
+			}
+
+			unique_lock<mutex> lock(this->lock_tail());
+
+			segment* tail = this->m_tail;
+			int end = tail->m_end.load(memory_order_relaxed);
+
+			if (end == segment_size)
+			{
+				segment* const next = new segment;
+
+				tail->m_next.store(next);
+				this->m_tail = tail = next;
+				end = 0;
+			}
+
+			new (tail->get_data(end)) _Ty(move(item));
+			tail->m_end.store(end + 1);
+
+			lock.unlock();
+			lock.release();
+
+			this->notify_waiters();
+			res = true;
+		}
+
+		std::shared_ptr<_Ty> try_pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->try_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		bool try_pop(_Ty& res)
+		{
+			using namespace std;
+
+			unique_lock<mutex> lock(this->lock_head());
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		std::shared_ptr<_Ty> wait_and_pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->wait_and_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		bool wait_and_pop(_Ty& res)
+		{
+			using namespace std;
+
+			unique_lock<mutex> lock(this->lock_head());
+
+			this->m_waiters.fetch_add(1);
+			this->m_cv.wait(lock, [&]()->bool { return !m_is_active || has_data(); });
+			this->m_waiters.fetch_sub(1);
+
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		bool is_empty() const
+		{
+			using namespace std;
+
+			unique_lock<mutex> lock(this->lock_head());
+			return !this->has_data();
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+		int clear()
+		{
+			using namespace std;
+
+			scoped_lock s_lock(this->m_head_mutex, this->m_tail_mutex);
+
+			const int j = this->delete_segments();
+			this->m_head = this->m_tail = new segment;
+
+			return j;
+		}
+
+	private:
+		mutable std::mutex      m_head_mutex;
+		mutable std::mutex      m_tail_mutex;
+		segment*                m_head;
+		segment*                m_tail;
+		std::condition_variable m_cv;
+		std::atomic<bool>       m_is_active;
+		std::atomic<int>        m_waiters;
+};
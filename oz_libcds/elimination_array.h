@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Elimination backoff for Treiber stacks: a push and a pop that both failed their CAS on the head meet in
+// a random slot and exchange the node directly. The pusher's node was never linked into the stack, so the
+// popper owns it outright and frees it without going through the reclamation scheme.
+// The number of slots in use adapts to contention: it grows when a pusher finds its slot taken
+// and shrinks when a pusher waits in vain.
+template<typename _Node, int capacity = 16, int spin_count = 256> class elimination_array
+{
+	static constexpr std::size_t cache_line_size = 64;
+
+	class slot
+	{
+		public:
+			slot()
+				: m_item{ nullptr }
+			{
+			}
+
+			alignas(cache_line_size) std::atomic<_Node*> m_item;
+	};
+
+	public:
+		elimination_array()
+			: m_width{ 1 }
+		{
+			static_assert(capacity > 0, "capacity must be positive");
+		}
+
+		elimination_array(const elimination_array&) = delete;
+		elimination_array& operator=(const elimination_array&) = delete;
+
+		// returns true when a popper has taken the item
+		bool try_push(_Node* item)
+		{
+			using namespace std;
+
+			std::atomic<_Node*>& target = this->m_slots[this->get_slot()].m_item;
+			_Node* empty = nullptr;
+
+			if (!target.compare_exchange_strong(empty, item, memory_order_release, memory_order_relaxed))
+			{
+				this->resize(1);
+				return false;
+			}
+
+			for (int i = 0; i < spin_count; i++)
+			{
+				if (target.load(memory_order_relaxed) != item)
+				{
+					target.store(nullptr, memory_order_relaxed);
+					return true;
+				}
+			}
+
+			if (target.compare_exchange_strong(item, nullptr, memory_order_relaxed))
+			{
+				this->resize(-1);
+				return false;
+			}
+
+			// a popper took the item between the last check and the withdrawal
+			target.store(nullptr, memory_order_relaxed);
+			return true;
+		}
+
+		// returns a node handed over by a waiting pusher, or nullptr
+		_Node* try_pop()
+		{
+			using namespace std;
+
+			std::atomic<_Node*>& target = this->m_slots[this->get_slot()].m_item;
+			_Node* item = target.load(memory_order_relaxed);
+
+			if (item && item != elimination_array::taken() &&
+				target.compare_exchange_strong(item, elimination_array::taken(), memory_order_acquire, memory_order_relaxed))
+			{
+				return item;
+			}
+
+			return nullptr;
+		}
+
+	private:
+		// marks a slot whose item was taken until the pusher clears it; never dereferenced
+		static _Node* taken()
+		{
+			static char marker;
+			return reinterpret_cast<_Node*>(&marker);
+		}
+
+		int get_slot() const
+		{
+			using namespace std;
+
+			thread_local static unsigned int seed = static_cast<unsigned int>(reinterpret_cast<std::size_t>(&seed)) | 1;
+
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+
+			return static_cast<int>(seed % static_cast<unsigned int>(this->m_width.load(memory_order_relaxed)));
+		}
+
+		void resize(int delta)
+		{
+			using namespace std;
+
+			// a heuristic, lost updates between racing threads do no harm
+			const int width = this->m_width.load(memory_order_relaxed) + delta;
+
+			if (width >= 1 && width <= capacity)
+			{
+				this->m_width.store(width, memory_order_relaxed);
+			}
+		}
+
+		slot             m_slots[capacity];
+		std::atomic<int> m_width;
+};
+
+// Stands in for elimination_array when elimination is disabled, the calls compile away.
+template<typename _Node> class no_elimination_array
+{
+	public:
+		bool try_push(_Node*)
+		{
+			return false;
+		}
+
+		_Node* try_pop()
+		{
+			return nullptr;
+		}
+};
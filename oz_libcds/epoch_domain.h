@@ -0,0 +1,339 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+class epoch_retire_record
+{
+	public:
+		epoch_retire_record()
+			: m_deleter{ nullptr }, m_retired_next{ nullptr }
+		{
+		}
+
+		void                 (*m_deleter)(epoch_retire_record*);
+		epoch_retire_record* m_retired_next;
+};
+
+template<int batch_size = 64> class epoch_domain
+{
+	static constexpr int limbo_lists = 3;
+
+	class record
+	{
+		public:
+			record()
+				: m_is_used{ true }, m_epoch{ 0 }, m_nesting{ 0 }, m_next{ nullptr }, m_retired_count{ 0 }, m_scan_count{ batch_size }
+			{
+				for (int i = 0; i < limbo_lists; i++)
+				{
+					this->m_limbo[i] = nullptr;
+					this->m_limbo_epoch[i] = 0;
+				}
+			}
+
+			void release()
+			{
+				// the limbo lists stay with the record and are freed by its next owner
+				this->m_epoch.store(0);
+				this->m_is_used.store(false);
+			}
+
+			std::atomic<bool>               m_is_used;
+			std::atomic<unsigned long long> m_epoch;
+			int                             m_nesting;
+			record*                         m_next;
+			epoch_retire_record*            m_limbo[limbo_lists];
+			unsigned long long              m_limbo_epoch[limbo_lists];
+			int                             m_retired_count;
+			int                             m_scan_count;
+	};
+
+	class record_list
+	{
+		public:
+			record_list()
+				: m_head{ nullptr }, m_is_active{ true }
+			{
+			}
+
+			~record_list()
+			{
+				record* item = this->m_head.load();
+
+				while (item)
+				{
+					record* const next = item->m_next;
+					delete item;
+
+					item = next;
+				}
+			}
+
+			record_list(const record_list&) = delete;
+			record_list& operator=(const record_list&) = delete;
+
+			record* acquire()
+			{
+				for (record* item = this->m_head.load(); item; item = item->m_next)
+				{
+					bool is_used = false;
+
+					if (!item->m_is_used.load() && item->m_is_used.compare_exchange_strong(is_used, true))
+					{
+						return item;
+					}
+				}
+
+				record* const item = new record;
+				item->m_next = this->m_head.load();
+
+				while (!this->m_head.compare_exchange_weak(item->m_next, item));
+
+				return item;
+			}
+
+			std::atomic<record*> m_head;
+			std::atomic<bool>    m_is_active;
+	};
+
+	class record_owner
+	{
+		public:
+			record_owner(std::shared_ptr<record_list> list)
+				: m_list{ std::move(list) }, m_record{ m_list->acquire() }
+			{
+			}
+
+			std::shared_ptr<record_list> m_list;
+			record*                      m_record;
+	};
+
+	class record_cache
+	{
+		public:
+			record_cache()
+				: m_last{ nullptr }
+			{
+			}
+
+			~record_cache()
+			{
+				for (record_owner& owner : this->m_owners)
+				{
+					owner.m_record->release();
+				}
+			}
+
+			record_cache(const record_cache&) = delete;
+			record_cache& operator=(const record_cache&) = delete;
+
+			record& get_record(const std::shared_ptr<record_list>& list)
+			{
+				using namespace std;
+
+				if (this->m_last && this->m_last->m_list == list)
+					return *this->m_last->m_record;
+
+				auto it = find_if(this->m_owners.begin(), this->m_owners.end(),
+					[&](const record_owner& owner)->bool { return owner.m_list == list; });
+
+				if (it == this->m_owners.end())
+				{
+					auto last = stable_partition(this->m_owners.begin(), this->m_owners.end(),
+						[](const record_owner& owner)->bool { return owner.m_list->m_is_active.load(); });
+
+					for (auto dead = last; dead != this->m_owners.end(); ++dead)
+					{
+						dead->m_record->release();
+					}
+
+					this->m_owners.erase(last, this->m_owners.end());
+					this->m_owners.emplace_back(list);
+
+					it = this->m_owners.end() - 1;
+				}
+
+				this->m_last = &*it;
+				return *it->m_record;
+			}
+
+		private:
+			std::vector<record_owner> m_owners;
+			record_owner*             m_last;
+	};
+
+	public:
+		class guard
+		{
+			public:
+				guard(epoch_domain& domain)
+					: m_domain{ domain }, m_record{ domain.get_record() }
+				{
+					this->m_domain.enter(this->m_record);
+				}
+
+				~guard()
+				{
+					this->m_domain.leave(this->m_record);
+				}
+
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+
+				template<typename _Tx> void retire(_Tx* item)
+				{
+					this->m_domain.retire(this->m_record, item);
+				}
+
+			private:
+				epoch_domain& m_domain;
+				record&       m_record;
+		};
+
+		epoch_domain()
+			: m_list{ std::make_shared<record_list>() }, m_epoch{ 1 }
+		{
+		}
+
+		~epoch_domain()
+		{
+			for (record* item = this->m_list->m_head.load(); item; item = item->m_next)
+			{
+				for (int i = 0; i < limbo_lists; i++)
+				{
+					epoch_domain::delete_records(item->m_limbo[i]);
+					item->m_limbo[i] = nullptr;
+				}
+
+				item->m_retired_count = 0;
+			}
+
+			this->m_list->m_is_active.store(false);
+		}
+
+		epoch_domain(const epoch_domain&) = delete;
+		epoch_domain& operator=(const epoch_domain&) = delete;
+
+		template<typename _Tx> void retire(_Tx* item)
+		{
+			this->retire(this->get_record(), item);
+		}
+
+		void clean_up_memory()
+		{
+			record& owner = this->get_record();
+
+			this->try_advance();
+			this->reclaim(owner, this->m_epoch.load());
+		}
+
+	private:
+		record& get_record()
+		{
+			thread_local static record_cache cache;
+			return cache.get_record(this->m_list);
+		}
+
+		void enter(record& owner)
+		{
+			if (owner.m_nesting++ == 0)
+			{
+				// the seq_cst store orders the announcement before every load made inside the critical section
+				owner.m_epoch.store(this->m_epoch.load());
+			}
+		}
+
+		void leave(record& owner)
+		{
+			using namespace std;
+
+			if (--owner.m_nesting == 0)
+			{
+				owner.m_epoch.store(0, memory_order_release);
+			}
+		}
+
+		template<typename _Tx> void retire(record& owner, _Tx* item)
+		{
+			using namespace std;
+
+			static_assert(is_base_of<epoch_retire_record, _Tx>::value, "retired type must derive from epoch_retire_record");
+
+			epoch_retire_record* const retired = item;
+			retired->m_deleter = [](epoch_retire_record* data)->void { delete static_cast<_Tx*>(data); };
+
+			const unsigned long long epoch = this->m_epoch.load();
+			const int i = static_cast<int>(epoch % limbo_lists);
+
+			if (owner.m_limbo_epoch[i] != epoch)
+			{
+				// the list was filled at least three epochs ago, nobody can still see it
+				owner.m_retired_count -= epoch_domain::delete_records(owner.m_limbo[i]);
+				owner.m_limbo[i] = nullptr;
+				owner.m_limbo_epoch[i] = epoch;
+			}
+
+			retired->m_retired_next = owner.m_limbo[i];
+			owner.m_limbo[i] = retired;
+
+			if (++owner.m_retired_count >= owner.m_scan_count)
+			{
+				this->try_advance();
+				this->reclaim(owner, this->m_epoch.load());
+
+				// a pinned reader keeps the lists full, the next attempt waits for another batch
+				owner.m_scan_count = owner.m_retired_count + batch_size;
+			}
+		}
+
+		void try_advance()
+		{
+			unsigned long long epoch = this->m_epoch.load();
+
+			for (record* item = this->m_list->m_head.load(); item; item = item->m_next)
+			{
+				const unsigned long long local = item->m_epoch.load();
+
+				if (local && local != epoch)
+					return;
+			}
+
+			this->m_epoch.compare_exchange_strong(epoch, epoch + 1);
+		}
+
+		void reclaim(record& owner, unsigned long long epoch)
+		{
+			for (int i = 0; i < limbo_lists; i++)
+			{
+				if (owner.m_limbo[i] && owner.m_limbo_epoch[i] + 2 <= epoch)
+				{
+					owner.m_retired_count -= epoch_domain::delete_records(owner.m_limbo[i]);
+					owner.m_limbo[i] = nullptr;
+				}
+			}
+		}
+
+		static int delete_records(epoch_retire_record* data)
+		{
+			int j = 0;
+
+			while (data)
+			{
+				epoch_retire_record* const next = data->m_retired_next;
+				data->m_deleter(data);
+
+				data = next;
+				++j;
+			}
+
+			return j;
+		}
+
+		std::shared_ptr<record_list>    m_list;
+		std::atomic<unsigned long long> m_epoch;
+};
@@ -4,8 +4,17 @@
 #include <memory>
 #include <initializer_list>
 
-template<typename _Ty> class exp_stack_atomic_shared_ptr
+#include "atomic_shared_ptr.h"
+#include "backoff.h"
+
+// _Policy is one of shared_ptr_free_functions, shared_ptr_split_count or shared_ptr_std_atomic
+template<typename _Ty, typename _Policy = shared_ptr_split_count, typename _Backoff = no_backoff> class exp_stack_atomic_shared_ptr
 {
+	class node;
+
+	using node_ptr        = typename _Policy::template pointer<node>;
+	using atomic_node_ptr = typename _Policy::template atomic_pointer<node>;
+
 	class node
 	{
 		public:
@@ -14,11 +23,13 @@ template<typename _Ty> class exp_stack_atomic_shared_ptr
 			{
 			}
 
-		std::shared_ptr<_Ty>  m_data;
-		std::shared_ptr<node> m_next;
+		std::shared_ptr<_Ty> m_data;
+		atomic_node_ptr      m_next;
 	};
 
 	public:
+		static constexpr bool is_always_lock_free = atomic_node_ptr::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
 		exp_stack_atomic_shared_ptr()
 			: m_is_active{ true }
 		{
@@ -96,27 +107,43 @@ template<typename _Ty> class exp_stack_atomic_shared_ptr
 		{
 			using namespace std;
 
-			shared_ptr<node> const item = make_shared<node>(data);
-			item->m_next = atomic_load(&this->m_head);
-			while (!atomic_compare_exchange_weak(&this->m_head, &item->m_next, item));
+			_Backoff backoff;
+
+			node_ptr const item = _Policy::template make<node>(data);
+			node_ptr next = this->m_head.load();
+
+			for (;;)
+			{
+				item->m_next.store(next);
+
+				if (this->m_head.compare_exchange_weak(next, item))
+					break;
+
+				backoff();
+			}
 		}
 
 		std::shared_ptr<_Ty> pop_item()
 		{
 			using namespace std;
 
-			shared_ptr<node> item = atomic_load(&this->m_head);
-			while (item && !atomic_compare_exchange_weak(&this->m_head, &item, atomic_load(&item->m_next)));
+			_Backoff backoff;
+
+			node_ptr item = this->m_head.load();
+
+			while (item && !this->m_head.compare_exchange_weak(item, item->m_next.load()))
+				backoff();
 
 			if (item)
 			{
-				atomic_store(&item->m_next, shared_ptr<node>());
+				// unlinks the popped node, so a long chain is never released recursively
+				item->m_next.store(node_ptr());
 				return item->m_data;
 			}
 
 			return shared_ptr<_Ty>();
 		}
 
-		std::shared_ptr<node> m_head;
-		std::atomic<bool>     m_is_active;
+		atomic_node_ptr   m_head;
+		std::atomic<bool> m_is_active;
 };
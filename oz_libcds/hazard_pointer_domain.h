@@ -0,0 +1,312 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+class hazard_retire_record
+{
+	public:
+		hazard_retire_record()
+			: m_retired_ptr{ nullptr }, m_deleter{ nullptr }, m_retired_next{ nullptr }
+		{
+		}
+
+		void*                 m_retired_ptr;
+		void                  (*m_deleter)(hazard_retire_record*);
+		hazard_retire_record* m_retired_next;
+};
+
+template<int hazards_per_thread = 2> class hazard_pointer_domain
+{
+	static constexpr int min_scan_threshold = 64;
+
+	class hp
+	{
+		public:
+			hp()
+				: m_is_used{ true }, m_next{ nullptr }, m_retired{ nullptr }, m_retired_count{ 0 }
+			{
+				for (int i = 0; i < hazards_per_thread; i++)
+				{
+					this->m_ptr[i].store(nullptr);
+				}
+			}
+
+			void release()
+			{
+				for (int i = 0; i < hazards_per_thread; i++)
+				{
+					this->m_ptr[i].store(nullptr);
+				}
+
+				// the retire list stays with the record and is scanned by its next owner
+				this->m_is_used.store(false);
+			}
+
+			std::atomic<bool>     m_is_used;
+			std::atomic<void*>    m_ptr[hazards_per_thread];
+			hp*                   m_next;
+			hazard_retire_record* m_retired;
+			int                   m_retired_count;
+	};
+
+	class hp_list
+	{
+		public:
+			hp_list()
+				: m_head{ nullptr }, m_count{ 0 }, m_is_active{ true }
+			{
+			}
+
+			~hp_list()
+			{
+				hp* item = this->m_head.load();
+
+				while (item)
+				{
+					hp* const next = item->m_next;
+					delete item;
+
+					item = next;
+				}
+			}
+
+			hp_list(const hp_list&) = delete;
+			hp_list& operator=(const hp_list&) = delete;
+
+			hp* acquire()
+			{
+				for (hp* item = this->m_head.load(); item; item = item->m_next)
+				{
+					bool is_used = false;
+
+					if (!item->m_is_used.load() && item->m_is_used.compare_exchange_strong(is_used, true))
+					{
+						return item;
+					}
+				}
+
+				hp* const item = new hp;
+				item->m_next = this->m_head.load();
+
+				while (!this->m_head.compare_exchange_weak(item->m_next, item));
+				this->m_count.fetch_add(1);
+
+				return item;
+			}
+
+			std::atomic<hp*>  m_head;
+			std::atomic<int>  m_count;
+			std::atomic<bool> m_is_active;
+	};
+
+	class hp_owner
+	{
+		public:
+			hp_owner(std::shared_ptr<hp_list> list)
+				: m_list{ std::move(list) }, m_hp{ m_list->acquire() }
+			{
+			}
+
+			std::shared_ptr<hp_list> m_list;
+			hp*                      m_hp;
+	};
+
+	class hp_cache
+	{
+		public:
+			hp_cache()
+				: m_last{ nullptr }
+			{
+			}
+
+			~hp_cache()
+			{
+				for (hp_owner& owner : this->m_owners)
+				{
+					owner.m_hp->release();
+				}
+			}
+
+			hp_cache(const hp_cache&) = delete;
+			hp_cache& operator=(const hp_cache&) = delete;
+
+			hp& get_record(const std::shared_ptr<hp_list>& list)
+			{
+				using namespace std;
+
+				if (this->m_last && this->m_last->m_list == list)
+					return *this->m_last->m_hp;
+
+				auto it = find_if(this->m_owners.begin(), this->m_owners.end(),
+					[&](const hp_owner& owner)->bool { return owner.m_list == list; });
+
+				if (it == this->m_owners.end())
+				{
+					// records of destroyed domains are dropped here, so a thread does not pin them forever
+					auto last = stable_partition(this->m_owners.begin(), this->m_owners.end(),
+						[](const hp_owner& owner)->bool { return owner.m_list->m_is_active.load(); });
+
+					for (auto dead = last; dead != this->m_owners.end(); ++dead)
+					{
+						dead->m_hp->release();
+					}
+
+					this->m_owners.erase(last, this->m_owners.end());
+					this->m_owners.emplace_back(list);
+
+					it = this->m_owners.end() - 1;
+				}
+
+				this->m_last = &*it;
+				return *it->m_hp;
+			}
+
+		private:
+			std::vector<hp_owner> m_owners;
+			hp_owner*             m_last;
+	};
+
+	public:
+		hazard_pointer_domain()
+			: m_list{ std::make_shared<hp_list>() }
+		{
+		}
+
+		~hazard_pointer_domain()
+		{
+			for (hp* item = this->m_list->m_head.load(); item; item = item->m_next)
+			{
+				hazard_pointer_domain::delete_records(item->m_retired);
+				item->m_retired = nullptr;
+				item->m_retired_count = 0;
+			}
+
+			this->m_list->m_is_active.store(false);
+		}
+
+		hazard_pointer_domain(const hazard_pointer_domain&) = delete;
+		hazard_pointer_domain& operator=(const hazard_pointer_domain&) = delete;
+
+		std::atomic<void*>& get_hazard_pointer(int i)
+		{
+			return this->get_record().m_ptr[i];
+		}
+
+		template<typename _Tx> _Tx* protect(int i, const std::atomic<_Tx*>& src)
+		{
+			std::atomic<void*>& hp = this->get_hazard_pointer(i);
+			_Tx* item = src.load();
+			_Tx* temp;
+
+			do
+			{
+				temp = item;
+				hp.store(item);
+				item = src.load();
+			} while (item != temp);
+
+			return item;
+		}
+
+		void clear(int i)
+		{
+			this->get_hazard_pointer(i).store(nullptr);
+		}
+
+		template<typename _Tx> void retire(_Tx* item)
+		{
+			using namespace std;
+
+			static_assert(is_base_of<hazard_retire_record, _Tx>::value, "retired type must derive from hazard_retire_record");
+
+			hazard_retire_record* const record = item;
+			record->m_retired_ptr = item;
+			record->m_deleter = [](hazard_retire_record* data)->void { delete static_cast<_Tx*>(data); };
+
+			hp& owner = this->get_record();
+			record->m_retired_next = owner.m_retired;
+			owner.m_retired = record;
+
+			const int threshold = max(2 * this->m_list->m_count.load(memory_order_relaxed) * hazards_per_thread, min_scan_threshold);
+
+			if (++owner.m_retired_count >= threshold)
+			{
+				this->scan(owner);
+			}
+		}
+
+		void clean_up_memory()
+		{
+			this->scan(this->get_record());
+		}
+
+	private:
+		hp& get_record()
+		{
+			thread_local static hp_cache cache;
+			return cache.get_record(this->m_list);
+		}
+
+		void scan(hp& owner)
+		{
+			using namespace std;
+
+			vector<void*> hazards;
+			hazards.reserve(this->m_list->m_count.load() * hazards_per_thread);
+
+			for (hp* item = this->m_list->m_head.load(); item; item = item->m_next)
+			{
+				for (int j = 0; j < hazards_per_thread; j++)
+				{
+					void* const ptr = item->m_ptr[j].load();
+
+					if (ptr)
+					{
+						hazards.push_back(ptr);
+					}
+				}
+			}
+
+			sort(hazards.begin(), hazards.end());
+
+			hazard_retire_record* record = owner.m_retired;
+			owner.m_retired = nullptr;
+			owner.m_retired_count = 0;
+
+			while (record)
+			{
+				hazard_retire_record* const next = record->m_retired_next;
+
+				if (binary_search(hazards.begin(), hazards.end(), record->m_retired_ptr))
+				{
+					record->m_retired_next = owner.m_retired;
+					owner.m_retired = record;
+					++owner.m_retired_count;
+				}
+				else
+				{
+					record->m_deleter(record);
+				}
+
+				record = next;
+			}
+		}
+
+		static void delete_records(hazard_retire_record* record)
+		{
+			while (record)
+			{
+				hazard_retire_record* const next = record->m_retired_next;
+				record->m_deleter(record);
+
+				record = next;
+			}
+		}
+
+		std::shared_ptr<hp_list> m_list;
+};
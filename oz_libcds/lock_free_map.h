@@ -0,0 +1,483 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "epoch_domain.h"
+
+// Split-ordered list hash map (Shalev, Shavit): all entries sit in one lock-free ordered list, sorted by their hash
+// with the bits reversed, and a bucket is a pointer to a sentinel node inside that list. Doubling the bucket count
+// never moves an entry, a new bucket only inserts its sentinel, which splits the parent bucket's run in two.
+// Sentinels are created on first use, the bucket array grows by segments and nodes are reclaimed through epochs.
+// Lookups only read shared memory: no lock, no reference count.
+template<typename _Key, typename _Val, typename _Hash = std::hash<_Key>> class lock_free_map
+{
+	static constexpr std::size_t max_load_factor = 1;
+	static constexpr int         max_segments    = 31;
+	static constexpr std::size_t max_buckets     = static_cast<std::size_t>(1) << max_segments;
+
+	// sentinels have even keys, entries odd ones, so an entry always follows its bucket's sentinel
+	class node : public epoch_retire_record
+	{
+		public:
+			node(std::uint64_t order_key)
+				: m_order_key{ order_key }, m_next{ nullptr }
+			{
+			}
+
+			bool is_sentinel() const
+			{
+				return !(this->m_order_key & 1);
+			}
+
+			const std::uint64_t m_order_key;
+			std::atomic<node*>  m_next;
+	};
+
+	// replaced as a whole by add_or_update, the old one is retired
+	class value : public epoch_retire_record
+	{
+		public:
+			value(const _Val& data)
+				: m_data{ data }
+			{
+			}
+
+			const _Val m_data;
+	};
+
+	class data_node : public node
+	{
+		public:
+			data_node(std::uint64_t order_key, const _Key& key, value* data)
+				: node(order_key), m_key{ key }, m_value{ data }
+			{
+			}
+
+			~data_node()
+			{
+				delete this->m_value.load(std::memory_order_relaxed);
+			}
+
+			const _Key          m_key;
+			std::atomic<value*> m_value;
+	};
+
+	using domain = epoch_domain<>;
+
+	public:
+		static constexpr bool is_always_lock_free =
+			std::atomic<node*>::is_always_lock_free && std::atomic<std::size_t>::is_always_lock_free;
+
+		lock_free_map(const _Hash& hasher = _Hash())
+			: m_hasher{ hasher }, m_bucket_count{ 2 }, m_size{ 0 }
+		{
+			for (int i = 0; i < max_segments; i++)
+			{
+				this->m_segments[i].store(nullptr);
+			}
+
+			this->get_slot(0).store(new node(0));
+		}
+
+		~lock_free_map()
+		{
+			node* item = this->get_slot(0).load();
+
+			while (item)
+			{
+				node* const next = lock_free_map::get_unmarked(item->m_next.load());
+				lock_free_map::delete_node(item);
+
+				item = next;
+			}
+
+			for (int i = 0; i < max_segments; i++)
+			{
+				delete[] this->m_segments[i].load();
+			}
+		}
+
+		lock_free_map(const lock_free_map&) = delete;
+		lock_free_map& operator=(const lock_free_map&) = delete;
+
+		_Val get_value(const _Key& key, const _Val& default_value = _Val()) const
+		{
+			_Val res = default_value;
+			this->get_value(key, res);
+
+			return res;
+		}
+
+		bool get_value(const _Key& key, _Val& value) const
+		{
+			using namespace std;
+
+			const size_t hash = this->m_hasher(key);
+			domain::guard guard(this->m_domain);
+
+			const data_node* const item = lock_free_map::find_node(this->get_bucket(hash), lock_free_map::get_regular_key(hash), key);
+
+			if (!item)
+			{
+				return false;
+			}
+
+			value = item->m_value.load(memory_order_acquire)->m_data;
+			return true;
+		}
+
+		bool add_or_update(const _Key& key, const _Val& data)
+		{
+			using namespace std;
+
+			const size_t hash = this->m_hasher(key);
+			const uint64_t order_key = lock_free_map::get_regular_key(hash);
+
+			value* const new_value = new value(data);
+			data_node* item = nullptr;
+
+			domain::guard guard(this->m_domain);
+			node* const head = this->get_bucket(hash);
+
+			for (;;)
+			{
+				atomic<node*>* prev = nullptr;
+				node* curr = nullptr;
+
+				if (lock_free_map::find(head, order_key, &key, prev, curr, guard))
+				{
+					value* const old_value = static_cast<data_node*>(curr)->m_value.exchange(new_value, memory_order_acq_rel);
+					guard.retire(old_value);
+
+					if (item)
+					{
+						// never published, it must not free the value it was given
+						item->m_value.store(nullptr, memory_order_relaxed);
+						delete item;
+					}
+
+					return false;
+				}
+
+				if (!item)
+				{
+					item = new data_node(order_key, key, new_value);
+				}
+
+				item->m_next.store(curr, memory_order_relaxed);
+
+				if (prev->compare_exchange_strong(curr, item, memory_order_release, memory_order_relaxed))
+					break;
+			}
+
+			const size_t size = this->m_size.fetch_add(1, memory_order_relaxed) + 1;
+			size_t bucket_count = this->m_bucket_count.load(memory_order_relaxed);
+
+			// the new buckets get their sentinels when they are first used
+			if (size > max_load_factor * bucket_count && bucket_count < max_buckets)
+			{
+				this->m_bucket_count.compare_exchange_strong(bucket_count, 2 * bucket_count, memory_order_relaxed);
+			}
+
+			return true;
+		}
+
+		bool remove(const _Key& key)
+		{
+			using namespace std;
+
+			const size_t hash = this->m_hasher(key);
+			const uint64_t order_key = lock_free_map::get_regular_key(hash);
+
+			domain::guard guard(this->m_domain);
+			node* const head = this->get_bucket(hash);
+
+			for (;;)
+			{
+				atomic<node*>* prev = nullptr;
+				node* curr = nullptr;
+
+				if (!lock_free_map::find(head, order_key, &key, prev, curr, guard))
+					return false;
+
+				node* next = curr->m_next.load();
+
+				if (lock_free_map::is_marked(next))
+					continue;
+
+				// the mark on the next pointer is the logical removal, it also fails every insert after this node
+				if (!curr->m_next.compare_exchange_strong(next, lock_free_map::get_marked(next)))
+					continue;
+
+				if (prev->compare_exchange_strong(curr, next))
+				{
+					guard.retire(static_cast<data_node*>(curr));
+				}
+				else
+				{
+					lock_free_map::find(head, order_key, &key, prev, curr, guard);
+				}
+
+				this->m_size.fetch_sub(1, memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// a snapshot that is only exact while no writer is running
+		std::map<_Key, _Val> get_map() const
+		{
+			using namespace std;
+
+			map<_Key, _Val> res;
+			domain::guard guard(this->m_domain);
+
+			for (node* item = this->get_slot(0).load(); item; item = lock_free_map::get_unmarked(item->m_next.load()))
+			{
+				if (!item->is_sentinel() && !lock_free_map::is_marked(item->m_next.load()))
+				{
+					const data_node* const entry = static_cast<const data_node*>(item);
+					res.insert(make_pair(entry->m_key, entry->m_value.load(memory_order_acquire)->m_data));
+				}
+			}
+
+			return res;
+		}
+
+		// the sentinels stay, so does the bucket count
+		int clear()
+		{
+			domain::guard guard(this->m_domain);
+			int res = 0;
+
+			for (node* item = this->get_slot(0).load(); item; item = lock_free_map::get_unmarked(item->m_next.load()))
+			{
+				if (!item->is_sentinel() && this->remove(static_cast<const data_node*>(item)->m_key))
+				{
+					++res;
+				}
+			}
+
+			return res;
+		}
+
+	private:
+		// the Harris-Michael search: stops at the entry for the key or where it would be inserted,
+		// and unlinks the marked nodes it passes. A null key looks for a sentinel
+		static bool find(node* head, std::uint64_t order_key, const _Key* key, std::atomic<node*>*& prev, node*& curr, domain::guard& guard)
+		{
+			using namespace std;
+
+			for (;;)
+			{
+				prev = &head->m_next;
+				curr = prev->load();
+
+				bool retry = false;
+
+				while (curr)
+				{
+					node* const next = curr->m_next.load();
+
+					if (lock_free_map::is_marked(next))
+					{
+						node* expected = curr;
+
+						if (!prev->compare_exchange_strong(expected, lock_free_map::get_unmarked(next)))
+						{
+							retry = true;
+							break;
+						}
+
+						guard.retire(static_cast<data_node*>(curr));
+						curr = lock_free_map::get_unmarked(next);
+
+						continue;
+					}
+
+					if (curr->m_order_key > order_key)
+						return false;
+
+					if (curr->m_order_key == order_key && (!key || static_cast<data_node*>(curr)->m_key == *key))
+						return true;
+
+					prev = &curr->m_next;
+					curr = next;
+				}
+
+				if (!retry)
+					return false;
+			}
+		}
+
+		// the read-only search of the lookups, it steps over marked nodes instead of unlinking them
+		static const data_node* find_node(const node* head, std::uint64_t order_key, const _Key& key)
+		{
+			for (const node* curr = lock_free_map::get_unmarked(head->m_next.load()); curr; )
+			{
+				node* const next = curr->m_next.load();
+
+				if (curr->m_order_key > order_key)
+					return nullptr;
+
+				if (curr->m_order_key == order_key && !lock_free_map::is_marked(next) &&
+					static_cast<const data_node*>(curr)->m_key == key)
+					return static_cast<const data_node*>(curr);
+
+				curr = lock_free_map::get_unmarked(next);
+			}
+
+			return nullptr;
+		}
+
+		node* get_bucket(std::size_t hash) const
+		{
+			using namespace std;
+
+			const size_t bucket = hash & (this->m_bucket_count.load(memory_order_relaxed) - 1);
+			node* const head = this->get_slot(bucket).load(memory_order_acquire);
+
+			return head ? head : this->initialize_bucket(bucket);
+		}
+
+		// links the bucket's sentinel into its parent bucket, the parent is the bucket without its highest bit.
+		// Racing threads agree on the sentinel that made it into the list
+		node* initialize_bucket(std::size_t bucket) const
+		{
+			using namespace std;
+
+			const size_t parent = bucket - (static_cast<size_t>(1) << lock_free_map::highest_bit(bucket));
+			const uint64_t order_key = lock_free_map::reverse_bits(bucket);
+
+			node* const head = this->get_bucket(parent);
+			node* sentinel = new node(order_key);
+
+			domain::guard guard(this->m_domain);
+
+			for (;;)
+			{
+				atomic<node*>* prev = nullptr;
+				node* curr = nullptr;
+
+				if (lock_free_map::find(head, order_key, nullptr, prev, curr, guard))
+				{
+					delete sentinel;
+					sentinel = curr;
+
+					break;
+				}
+
+				sentinel->m_next.store(curr, memory_order_relaxed);
+
+				if (prev->compare_exchange_strong(curr, sentinel, memory_order_release, memory_order_relaxed))
+					break;
+			}
+
+			this->get_slot(bucket).store(sentinel, memory_order_release);
+			return sentinel;
+		}
+
+		// segment 0 holds buckets 0 and 1, segment i > 0 holds buckets [2^i, 2^(i+1)),
+		// so a segment is allocated when the bucket count first reaches it and never moves
+		std::atomic<node*>& get_slot(std::size_t bucket) const
+		{
+			using namespace std;
+
+			const int segment = bucket < 2 ? 0 : lock_free_map::highest_bit(bucket);
+			const size_t first = segment ? static_cast<size_t>(1) << segment : 0;
+
+			atomic<node*>* slots = this->m_segments[segment].load(memory_order_acquire);
+
+			if (!slots)
+			{
+				const size_t size = segment ? first : 2;
+				atomic<node*>* const new_slots = new atomic<node*>[size];
+
+				for (size_t i = 0; i < size; i++)
+				{
+					new_slots[i].store(nullptr, memory_order_relaxed);
+				}
+
+				if (this->m_segments[segment].compare_exchange_strong(slots, new_slots, memory_order_acq_rel, memory_order_acquire))
+				{
+					slots = new_slots;
+				}
+				else
+				{
+					delete[] new_slots;
+				}
+			}
+
+			return slots[bucket - first];
+		}
+
+		static std::uint64_t get_regular_key(std::size_t hash)
+		{
+			return lock_free_map::reverse_bits(static_cast<std::uint64_t>(hash) | (static_cast<std::uint64_t>(1) << 63));
+		}
+
+		static std::uint64_t reverse_bits(std::uint64_t x)
+		{
+			x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+			x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+			x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+			x = ((x >> 8) & 0x00FF00FF00FF00FFull) | ((x & 0x00FF00FF00FF00FFull) << 8);
+			x = ((x >> 16) & 0x0000FFFF0000FFFFull) | ((x & 0x0000FFFF0000FFFFull) << 16);
+
+			return (x >> 32) | (x << 32);
+		}
+
+		// bucket indices stay below max_buckets, so 32 bits are enough
+		static int highest_bit(std::size_t bucket)
+		{
+#if defined(_MSC_VER)
+			unsigned long i = 0;
+			_BitScanReverse(&i, static_cast<unsigned long>(bucket));
+
+			return static_cast<int>(i);
+#else
+			return 31 - __builtin_clz(static_cast<unsigned int>(bucket));
+#endif
+		}
+
+		static bool is_marked(const node* item)
+		{
+			return reinterpret_cast<std::uintptr_t>(item) & 1;
+		}
+
+		static node* get_marked(node* item)
+		{
+			return reinterpret_cast<node*>(reinterpret_cast<std::uintptr_t>(item) | 1);
+		}
+
+		static node* get_unmarked(node* item)
+		{
+			return reinterpret_cast<node*>(reinterpret_cast<std::uintptr_t>(item) & ~static_cast<std::uintptr_t>(1));
+		}
+
+		static void delete_node(node* item)
+		{
+			if (item->is_sentinel())
+			{
+				delete item;
+			}
+			else
+			{
+				delete static_cast<data_node*>(item);
+			}
+		}
+
+		mutable std::atomic<std::atomic<node*>*> m_segments[max_segments];
+		mutable domain                           m_domain;
+		_Hash                                    m_hasher;
+		std::atomic<std::size_t>                 m_bucket_count;
+		std::atomic<std::size_t>                 m_size;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <initializer_list>
+
+#include "reclaimers.h"
+#include "backoff.h"
+
+template<typename _Ty, typename _Reclaimer = epoch_reclaimer, typename _Backoff = no_backoff> class lock_free_queue
+{
+	class node : public _Reclaimer::node_base
+	{
+		public:
+			node()
+				: m_next{ nullptr }
+			{
+			}
+
+			node(const _Ty& data)
+				: m_data{ std::make_shared<_Ty>(data) }, m_next{ nullptr }
+			{
+			}
+
+			std::shared_ptr<_Ty> m_data;
+			std::atomic<node*>   m_next;
+	};
+
+	using guard = typename _Reclaimer::guard;
+
+	public:
+		static constexpr bool is_always_lock_free = std::atomic<node*>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
+		lock_free_queue()
+			: m_head{ new node }, m_is_active{ true }
+		{
+			this->m_tail.store(this->m_head.load());
+		}
+
+		lock_free_queue(std::initializer_list<_Ty>& init_list)
+			: lock_free_queue()
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				this->push_item(*it);
+				++it;
+			}
+		}
+
+		~lock_free_queue()
+		{
+			this->m_is_active = false;
+
+			node* item = this->m_head.load();
+
+			while (item)
+			{
+				node* const next = item->m_next.load();
+				delete item;
+
+				item = next;
+			}
+		}
+
+		lock_free_queue(const lock_free_queue&) = delete;
+		lock_free_queue& operator=(const lock_free_queue&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			if (this->m_is_active)
+			{
+				this->push_item(data);
+				res = true;
+
+				return;
+			}
+
+			res = false;
+		}
+
+		std::shared_ptr<_Ty> pop()
+		{
+			using namespace std;
+
+			if (this->m_is_active)
+				return this->pop_item();
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			int j = 0;
+
+			while (this->pop())
+			{
+				++j;
+			}
+
+			return j;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		void push_item(const _Ty& data)
+		{
+			node* const item = new node(data);
+			guard reclaimer_guard(this->m_reclaimer);
+			_Backoff backoff;
+
+			for (;;)
+			{
+				node* tail = reclaimer_guard.protect(0, this->m_tail);
+				node* next = tail->m_next.load();
+
+				if (tail != this->m_tail.load())
+					continue;
+
+				if (next)
+				{
+					this->m_tail.compare_exchange_strong(tail, next);
+					continue;
+				}
+
+				if (tail->m_next.compare_exchange_strong(next, item))
+				{
+					this->m_tail.compare_exchange_strong(tail, item);
+					break;
+				}
+
+				backoff();
+			}
+		}
+
+		std::shared_ptr<_Ty> pop_item()
+		{
+			using namespace std;
+
+			guard reclaimer_guard(this->m_reclaimer);
+			_Backoff backoff;
+			shared_ptr<_Ty> res;
+
+			for (;;)
+			{
+				node* head = reclaimer_guard.protect(0, this->m_head);
+				node* tail = this->m_tail.load();
+				node* const next = reclaimer_guard.protect(1, head->m_next);
+
+				if (head != this->m_head.load())
+					continue;
+
+				if (!next)
+					break;
+
+				if (head == tail)
+				{
+					this->m_tail.compare_exchange_strong(tail, next);
+					continue;
+				}
+
+				if (this->m_head.compare_exchange_strong(head, next))
+				{
+					res.swap(next->m_data);
+					reclaimer_guard.retire(head);
+
+					break;
+				}
+
+				backoff();
+			}
+
+			return res;
+		}
+
+		std::atomic<node*> m_head;
+		std::atomic<node*> m_tail;
+		_Reclaimer         m_reclaimer;
+		std::atomic<bool>  m_is_active;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <utility>
+#include <initializer_list>
+
+#include "backoff.h"
+
+template<typename _Ty, typename _Backoff = no_backoff> class lock_free_queue_bounded
+{
+	static constexpr std::size_t cache_line_size = 64;
+
+	class cell
+	{
+		public:
+			_Ty* get_data()
+			{
+				return reinterpret_cast<_Ty*>(this->m_storage);
+			}
+
+			std::atomic<std::size_t> m_sequence;
+			alignas(_Ty) unsigned char m_storage[sizeof(_Ty)];
+	};
+
+	public:
+		static constexpr bool is_always_lock_free = std::atomic<std::size_t>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
+		explicit lock_free_queue_bounded(std::size_t capacity = 1024)
+			: m_mask{ lock_free_queue_bounded::round_up(capacity) - 1 }, m_head{ 0 }, m_tail{ 0 }, m_is_active{ true }
+		{
+			using namespace std;
+
+			this->m_cells = make_unique<cell[]>(this->m_mask + 1);
+
+			for (size_t i = 0; i <= this->m_mask; i++)
+			{
+				this->m_cells[i].m_sequence.store(i, memory_order_relaxed);
+			}
+		}
+
+		lock_free_queue_bounded(std::size_t capacity, std::initializer_list<_Ty>& init_list)
+			: lock_free_queue_bounded(capacity)
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end() && this->push_item(*it))
+			{
+				++it;
+			}
+		}
+
+		~lock_free_queue_bounded()
+		{
+			this->m_is_active = false;
+			this->clear_items();
+		}
+
+		lock_free_queue_bounded(const lock_free_queue_bounded&) = delete;
+		lock_free_queue_bounded& operator=(const lock_free_queue_bounded&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			using namespace std;
+
+			while (this->m_is_active)
+			{
+				if (this->push_item(data))
+				{
+					res = true;
+					return;
+				}
+
+				this_thread::yield();
+			}
+
+			res = false;
+		}
+
+		bool try_push(const _Ty& data)
+		{
+			return this->m_is_active && this->push_item(data);
+		}
+
+		bool try_pop(_Ty& res)
+		{
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		std::shared_ptr<_Ty> try_pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->try_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			if (!this->m_is_active)
+				return 0;
+
+			return this->clear_items();
+		}
+
+		std::size_t capacity() const
+		{
+			return this->m_mask + 1;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		static std::size_t round_up(std::size_t capacity)
+		{
+			std::size_t res = 2;
+
+			while (res < capacity)
+			{
+				res <<= 1;
+			}
+
+			return res;
+		}
+
+		bool push_item(const _Ty& data)
+		{
+			using namespace std;
+
+			_Backoff backoff;
+			cell* item = nullptr;
+			size_t pos = this->m_tail.load(memory_order_relaxed);
+
+			for (;;)
+			{
+				item = &this->m_cells[pos & this->m_mask];
+
+				const size_t seq = item->m_sequence.load(memory_order_acquire);
+				const ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+
+				if (!diff)
+				{
+					if (this->m_tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+						break;
+
+					backoff();
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = this->m_tail.load(memory_order_relaxed);
+				}
+			}
+
+			new (item->m_storage) _Ty(data);
+			item->m_sequence.store(pos + 1, memory_order_release);
+
+			return true;
+		}
+
+		bool pop_item(_Ty& res)
+		{
+			using namespace std;
+
+			_Backoff backoff;
+			cell* item = nullptr;
+			size_t pos = this->m_head.load(memory_order_relaxed);
+
+			for (;;)
+			{
+				item = &this->m_cells[pos & this->m_mask];
+
+				const size_t seq = item->m_sequence.load(memory_order_acquire);
+				const ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+
+				if (!diff)
+				{
+					if (this->m_head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+						break;
+
+					backoff();
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = this->m_head.load(memory_order_relaxed);
+				}
+			}
+
+			_Ty* const data = item->get_data();
+
+			res = move(*data);
+			data->~_Ty();
+
+			item->m_sequence.store(pos + this->m_mask + 1, memory_order_release);
+
+			return true;
+		}
+
+		int clear_items()
+		{
+			using namespace std;
+
+			int j = 0;
+			_Ty item;
+
+			while (this->pop_item(item))
+			{
+				++j;
+			}
+
+			return j;
+		}
+
+		std::unique_ptr<cell[]> m_cells;
+		const std::size_t       m_mask;
+
+		alignas(cache_line_size) std::atomic<std::size_t> m_head;
+		alignas(cache_line_size) std::atomic<std::size_t> m_tail;
+		alignas(cache_line_size) std::atomic<bool>        m_is_active;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "lock_free_queue.h"
+
+// the Michael-Scott queue with epoch-based reclamation, kept under its own name for existing users
+template<typename _Ty, typename _Backoff = no_backoff> using lock_free_queue_epoch = lock_free_queue<_Ty, epoch_reclaimer, _Backoff>;
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <initializer_list>
+
+#include "hazard_pointer_domain.h"
+#include "backoff.h"
+
+template<typename _Ty, int segment_size = 1024, typename _Backoff = no_backoff> class lock_free_queue_faa
+{
+	enum slot_state : int { empty_slot, ready_slot, taken_slot };
+
+	class segment : public hazard_retire_record
+	{
+		public:
+			segment()
+				: m_enq_index{ 0 }, m_deq_index{ 0 }, m_next{ nullptr }
+			{
+				for (int i = 0; i < segment_size; i++)
+				{
+					this->m_states[i].store(empty_slot, std::memory_order_relaxed);
+				}
+			}
+
+			segment(const _Ty& data)
+				: segment()
+			{
+				new (this->get_data(0)) _Ty(data);
+
+				this->m_states[0].store(ready_slot, std::memory_order_relaxed);
+				this->m_enq_index.store(1, std::memory_order_relaxed);
+			}
+
+			~segment()
+			{
+				for (int i = 0; i < segment_size; i++)
+				{
+					if (this->m_states[i].load(std::memory_order_relaxed) == ready_slot)
+					{
+						this->get_data(i)->~_Ty();
+					}
+				}
+			}
+
+			segment(const segment&) = delete;
+			segment& operator=(const segment&) = delete;
+
+			_Ty* get_data(int i)
+			{
+				return reinterpret_cast<_Ty*>(this->m_storage) + i;
+			}
+
+			std::atomic<int>      m_enq_index;
+			std::atomic<int>      m_deq_index;
+			std::atomic<segment*> m_next;
+			std::atomic<int>      m_states[segment_size];
+
+			alignas(_Ty) unsigned char m_storage[segment_size * sizeof(_Ty)];
+	};
+
+	using domain = hazard_pointer_domain<1>;
+
+	public:
+		static constexpr bool is_always_lock_free =
+			std::atomic<segment*>::is_always_lock_free &&
+			std::atomic<int>::is_always_lock_free &&
+			std::atomic<bool>::is_always_lock_free;
+
+		lock_free_queue_faa()
+			: m_head{ new segment }, m_is_active{ true }
+		{
+			this->m_tail.store(this->m_head.load());
+		}
+
+		lock_free_queue_faa(std::initializer_list<_Ty>& init_list)
+			: lock_free_queue_faa()
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				this->push_item(*it);
+				++it;
+			}
+		}
+
+		~lock_free_queue_faa()
+		{
+			this->m_is_active = false;
+
+			segment* item = this->m_head.load();
+
+			while (item)
+			{
+				segment* const next = item->m_next.load();
+				delete item;
+
+				item = next;
+			}
+		}
+
+		lock_free_queue_faa(const lock_free_queue_faa&) = delete;
+		lock_free_queue_faa& operator=(const lock_free_queue_faa&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			if (this->m_is_active)
+			{
+				this->push_item(data);
+				res = true;
+
+				return;
+			}
+
+			res = false;
+		}
+
+		bool try_pop(_Ty& res)
+		{
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		std::shared_ptr<_Ty> pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->try_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			int j = 0;
+			_Ty item;
+
+			while (this->try_pop(item))
+			{
+				++j;
+			}
+
+			return j;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		void push_item(const _Ty& data)
+		{
+			using namespace std;
+
+			domain& hazards = this->m_domain;
+			_Backoff backoff;
+
+			for (;;)
+			{
+				segment* tail = hazards.protect(0, this->m_tail);
+				const int i = tail->m_enq_index.fetch_add(1);
+
+				if (i >= segment_size)
+				{
+					if (tail != this->m_tail.load())
+						continue;
+
+					segment* next = tail->m_next.load();
+
+					if (!next)
+					{
+						segment* const item = new segment(data);
+
+						if (tail->m_next.compare_exchange_strong(next, item))
+						{
+							this->m_tail.compare_exchange_strong(tail, item);
+							break;
+						}
+
+						delete item;
+						backoff();
+					}
+					else
+					{
+						this->m_tail.compare_exchange_strong(tail, next);
+					}
+
+					continue;
+				}
+
+				_Ty* const slot = new (tail->get_data(i)) _Ty(data);
+				int state = empty_slot;
+
+				if (tail->m_states[i].compare_exchange_strong(state, ready_slot))
+					break;
+
+				slot->~_Ty();
+				backoff();
+			}
+
+			hazards.clear(0);
+		}
+
+		bool pop_item(_Ty& res)
+		{
+			using namespace std;
+
+			domain& hazards = this->m_domain;
+			_Backoff backoff;
+			bool is_found = false;
+
+			for (;;)
+			{
+				segment* head = hazards.protect(0, this->m_head);
+
+				if (head->m_deq_index.load() >= head->m_enq_index.load() && !head->m_next.load())
+					break;
+
+				const int i = head->m_deq_index.fetch_add(1);
+
+				if (i >= segment_size)
+				{
+					segment* const next = head->m_next.load();
+
+					if (!next)
+						break;
+
+					segment* tail = head;
+					this->m_tail.compare_exchange_strong(tail, next);
+
+					if (this->m_head.compare_exchange_strong(head, next))
+					{
+						hazards.clear(0);
+						hazards.retire(head);
+					}
+
+					continue;
+				}
+
+				if (head->m_states[i].exchange(taken_slot) == ready_slot)
+				{
+					_Ty* const data = head->get_data(i);
+
+					res = move(*data);
+					data->~_Ty();
+
+					is_found = true;
+					break;
+				}
+
+				backoff();
+			}
+
+			hazards.clear(0);
+
+			return is_found;
+		}
+
+		std::atomic<segment*> m_head;
+		std::atomic<segment*> m_tail;
+		domain                m_domain;
+		std::atomic<bool>     m_is_active;
+};
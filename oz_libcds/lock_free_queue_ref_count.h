@@ -2,9 +2,12 @@
 
 #include <atomic>
 #include <memory>
+#include <cstdint>
 #include <initializer_list>
 
-template<typename _Ty> class lock_free_queue_ref_count
+#include "backoff.h"
+
+template<typename _Ty, typename _Backoff = no_backoff> class lock_free_queue_ref_count
 {
 	class node;
 
@@ -15,8 +18,9 @@ template<typename _Ty> class lock_free_queue_ref_count
 		{
 		}
 
-		node* m_node;
-		int   m_external_counter;
+		// pointer-sized counter keeps the struct free of padding bytes, the CAS on m_next compares with a fresh value
+		node*         m_node;
+		std::intptr_t m_external_counter;
 	};
 
 	struct node_counter
@@ -33,27 +37,35 @@ template<typename _Ty> class lock_free_queue_ref_count
 	class node
 	{
 		public:
-			node() : m_data{ nullptr }, m_is_free{ true }
+			node() : m_data{ nullptr }
 			{
 				node_counter counter;
 				counter.m_internal_counter = 0;
 				counter.m_counters = 2;
 
 				this->m_counter.store(counter);
+				this->m_next.store(counted_node_ptr());
 			}
 
 			bool release_ref()
 			{
 				using namespace std;
 
+				_Backoff backoff;
+
 				node_counter old_counter = this->m_counter.load();
 				node_counter new_counter;
 
-				do
+				for (;;)
 				{
 					new_counter = old_counter;
 					--new_counter.m_internal_counter;
-				} while (!this->m_counter.compare_exchange_strong(old_counter, new_counter));
+
+					if (this->m_counter.compare_exchange_strong(old_counter, new_counter))
+						break;
+
+					backoff();
+				}
 
 				if (!new_counter.m_internal_counter && !new_counter.m_counters)
 				{
@@ -64,13 +76,17 @@ template<typename _Ty> class lock_free_queue_ref_count
 				return false;
 			}
 
-			std::shared_ptr<_Ty>      m_data;
-			counted_node_ptr          m_next;
-			std::atomic<node_counter> m_counter;
-			std::atomic<bool>         m_is_free;
+			std::atomic<_Ty*>             m_data;
+			std::atomic<counted_node_ptr> m_next;
+			std::atomic<node_counter>     m_counter;
 	};
 
 	public:
+		static constexpr bool is_always_lock_free =
+			std::atomic<counted_node_ptr>::is_always_lock_free &&
+			std::atomic<node_counter>::is_always_lock_free &&
+			std::atomic<bool>::is_always_lock_free;
+
 		lock_free_queue_ref_count() 
 			: m_is_active{ true }
 		{
@@ -157,12 +173,13 @@ template<typename _Ty> class lock_free_queue_ref_count
 		{
 			using namespace std;
 
-			shared_ptr<_Ty> data_ptr(make_shared<_Ty>(data));
+			unique_ptr<_Ty> data_ptr(make_unique<_Ty>(data));
 
 			counted_node_ptr new_next;
 			new_next.m_node = new node;
 			new_next.m_external_counter = 1;
 
+			_Backoff backoff;
 			counted_node_ptr old_tail = this->m_tail.load();
 
 			for (;;)
@@ -170,18 +187,52 @@ template<typename _Ty> class lock_free_queue_ref_count
 				this->increase_external_counter(this->m_tail, old_tail);
 				node* const p_node = old_tail.m_node;
 
-				bool is_free = true;
+				_Ty* old_data = nullptr;
 
-				if (p_node->m_is_free.compare_exchange_strong(is_free, false))
+				if (p_node->m_data.compare_exchange_strong(old_data, data_ptr.get()))
 				{
-					p_node->m_data = move(data_ptr);
-					p_node->m_next = new_next;
-					old_tail = this->m_tail.exchange(new_next);
-					this->free_external_counter(old_tail);
+					counted_node_ptr old_next;
+
+					if (!p_node->m_next.compare_exchange_strong(old_next, new_next))
+					{
+						delete new_next.m_node;
+						new_next = old_next;
+					}
+
+					this->set_new_tail(old_tail, new_next);
+					data_ptr.release();
 
 					return;
 				}
 
+				counted_node_ptr old_next;
+
+				if (p_node->m_next.compare_exchange_strong(old_next, new_next))
+				{
+					old_next = new_next;
+					new_next.m_node = new node;
+				}
+
+				this->set_new_tail(old_tail, old_next);
+				backoff();
+			}
+		}
+
+		void set_new_tail(counted_node_ptr& old_tail, const counted_node_ptr& new_tail)
+		{
+			_Backoff backoff;
+			node* const p_node = old_tail.m_node;
+
+			while (!this->m_tail.compare_exchange_weak(old_tail, new_tail) &&
+				old_tail.m_node == p_node)
+				backoff();
+
+			if (old_tail.m_node == p_node)
+			{
+				this->free_external_counter(old_tail);
+			}
+			else
+			{
 				p_node->release_ref();
 			}
 		}
@@ -190,6 +241,7 @@ template<typename _Ty> class lock_free_queue_ref_count
 		{
 			using namespace std;
 
+			_Backoff backoff;
 			counted_node_ptr old_head = this->m_head.load();
 
 			for (;;)
@@ -203,16 +255,19 @@ template<typename _Ty> class lock_free_queue_ref_count
 					return shared_ptr<_Ty>();
 				}
 
-				if (this->m_head.compare_exchange_strong(old_head, p_node->m_next))
+				counted_node_ptr next = p_node->m_next.load();
+
+				if (this->m_head.compare_exchange_strong(old_head, next))
 				{
-					shared_ptr<_Ty> res;
-					res.swap(p_node->m_data);
+					// the data pointer stays set, a stale pusher must not refill a dequeued node
+					shared_ptr<_Ty> res(p_node->m_data.load());
 					this->free_external_counter(old_head);
 
 					return res;
 				}
 
 				p_node->release_ref();
+				backoff();
 			}
 		}
 
@@ -220,13 +275,19 @@ template<typename _Ty> class lock_free_queue_ref_count
 		{
 			using namespace std;
 
+			_Backoff backoff;
 			counted_node_ptr new_counter;
-			
-			do
+
+			for (;;)
 			{
 				new_counter = old_counter;
 				++new_counter.m_external_counter;
-			} while (!counter.compare_exchange_strong(old_counter, new_counter));
+
+				if (counter.compare_exchange_strong(old_counter, new_counter))
+					break;
+
+				backoff();
+			}
 
 			old_counter.m_external_counter = new_counter.m_external_counter;
 		}
@@ -236,17 +297,24 @@ template<typename _Ty> class lock_free_queue_ref_count
 			using namespace std;
 
 			node* const p_node = node_ptr.m_node;
-			int const inc = node_ptr.m_external_counter - 2;
+			int const inc = static_cast<int>(node_ptr.m_external_counter - 2);
+
+			_Backoff backoff;
 
 			node_counter old_counter = p_node->m_counter.load();
 			node_counter new_counter;
 
-			do
+			for (;;)
 			{
 				new_counter = old_counter;
 				--new_counter.m_counters;
 				new_counter.m_internal_counter += inc;
-			} while (!p_node->m_counter.compare_exchange_strong(old_counter, new_counter));
+
+				if (p_node->m_counter.compare_exchange_strong(old_counter, new_counter))
+					break;
+
+				backoff();
+			}
 
 			if (!new_counter.m_internal_counter && !new_counter.m_counters)
 			{
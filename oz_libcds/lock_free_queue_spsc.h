@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+
+template<typename _Ty> class lock_free_queue_spsc
+{
+	static constexpr std::size_t cache_line_size = 64;
+
+	public:
+		static constexpr bool is_always_lock_free = std::atomic<std::size_t>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
+		explicit lock_free_queue_spsc(std::size_t capacity = 1024)
+			: m_mask{ lock_free_queue_spsc::round_up(capacity) - 1 }, m_items{ std::make_unique<_Ty[]>(m_mask + 1) },
+			  m_tail{ 0 }, m_head_cache{ 0 }, m_head{ 0 }, m_tail_cache{ 0 }, m_is_active{ true }
+		{
+		}
+
+		lock_free_queue_spsc(std::size_t capacity, std::initializer_list<_Ty>& init_list)
+			: lock_free_queue_spsc(capacity)
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end() && this->push_item(*it))
+			{
+				++it;
+			}
+		}
+
+		~lock_free_queue_spsc()
+		{
+			this->m_is_active = false;
+		}
+
+		lock_free_queue_spsc(const lock_free_queue_spsc&) = delete;
+		lock_free_queue_spsc& operator=(const lock_free_queue_spsc&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			using namespace std;
+
+			while (this->m_is_active)
+			{
+				if (this->push_item(data))
+				{
+					res = true;
+					return;
+				}
+
+				this_thread::yield();
+			}
+
+			res = false;
+		}
+
+		bool try_push(const _Ty& data)
+		{
+			return this->m_is_active && this->push_item(data);
+		}
+
+		bool try_pop(_Ty& res)
+		{
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		std::shared_ptr<_Ty> try_pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->try_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		std::pair<_Ty*, std::size_t> write_span()
+		{
+			using namespace std;
+
+			const size_t tail = this->m_tail.load(memory_order_relaxed);
+
+			if (tail - this->m_head_cache > this->m_mask)
+			{
+				this->m_head_cache = this->m_head.load(memory_order_acquire);
+			}
+
+			const size_t free_items = this->m_mask + 1 - (tail - this->m_head_cache);
+			const size_t offset = tail & this->m_mask;
+
+			return make_pair(&this->m_items[offset], min(free_items, this->m_mask + 1 - offset));
+		}
+
+		void commit_write(std::size_t count)
+		{
+			using namespace std;
+
+			this->m_tail.store(this->m_tail.load(memory_order_relaxed) + count, memory_order_release);
+		}
+
+		std::pair<_Ty*, std::size_t> read_span()
+		{
+			using namespace std;
+
+			const size_t head = this->m_head.load(memory_order_relaxed);
+
+			if (this->m_tail_cache == head)
+			{
+				this->m_tail_cache = this->m_tail.load(memory_order_acquire);
+			}
+
+			const size_t items = this->m_tail_cache - head;
+			const size_t offset = head & this->m_mask;
+
+			return make_pair(&this->m_items[offset], min(items, this->m_mask + 1 - offset));
+		}
+
+		void commit_read(std::size_t count)
+		{
+			using namespace std;
+
+			this->m_head.store(this->m_head.load(memory_order_relaxed) + count, memory_order_release);
+		}
+
+		int clear()
+		{
+			using namespace std;
+
+			if (!this->m_is_active)
+				return 0;
+
+			int j = 0;
+			pair<_Ty*, size_t> span = this->read_span();
+
+			while (span.second)
+			{
+				j += static_cast<int>(span.second);
+				this->commit_read(span.second);
+
+				span = this->read_span();
+			}
+
+			return j;
+		}
+
+		std::size_t capacity() const
+		{
+			return this->m_mask + 1;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		static std::size_t round_up(std::size_t capacity)
+		{
+			std::size_t res = 2;
+
+			while (res < capacity)
+			{
+				res <<= 1;
+			}
+
+			return res;
+		}
+
+		bool push_item(const _Ty& data)
+		{
+			using namespace std;
+
+			const size_t tail = this->m_tail.load(memory_order_relaxed);
+
+			if (tail - this->m_head_cache > this->m_mask)
+			{
+				this->m_head_cache = this->m_head.load(memory_order_acquire);
+
+				if (tail - this->m_head_cache > this->m_mask)
+					return false;
+			}
+
+			this->m_items[tail & this->m_mask] = data;
+			this->m_tail.store(tail + 1, memory_order_release);
+
+			return true;
+		}
+
+		bool pop_item(_Ty& res)
+		{
+			using namespace std;
+
+			const size_t head = this->m_head.load(memory_order_relaxed);
+
+			if (this->m_tail_cache == head)
+			{
+				this->m_tail_cache = this->m_tail.load(memory_order_acquire);
+
+				if (this->m_tail_cache == head)
+					return false;
+			}
+
+			res = move(this->m_items[head & this->m_mask]);
+			this->m_head.store(head + 1, memory_order_release);
+
+			return true;
+		}
+
+		const std::size_t      m_mask;
+		std::unique_ptr<_Ty[]> m_items;
+
+		alignas(cache_line_size) std::atomic<std::size_t> m_tail;
+		std::size_t                                       m_head_cache;
+
+		alignas(cache_line_size) std::atomic<std::size_t> m_head;
+		std::size_t                                       m_tail_cache;
+
+		alignas(cache_line_size) std::atomic<bool>        m_is_active;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <atomic>
+#include <type_traits>
+#include <initializer_list>
+
+#include "reclaimers.h"
+#include "elimination_array.h"
+#include "backoff.h"
+
+// use_elimination lets a push and a pop that both failed their CAS on the head exchange the node in an elimination_array
+template<typename _Ty, typename _Reclaimer = epoch_reclaimer, typename _Backoff = no_backoff, bool use_elimination = false> class lock_free_stack
+{
+	class node : public _Reclaimer::node_base
+	{
+		public:
+			node(const _Ty& data)
+				: m_data_ptr{ std::make_shared<_Ty>(data) }, m_next{ nullptr }
+			{
+			}
+
+			std::shared_ptr<_Ty> m_data_ptr;
+			node* m_next;
+	};
+
+	using guard       = typename _Reclaimer::guard;
+	using elimination = typename std::conditional<use_elimination, elimination_array<node>, no_elimination_array<node>>::type;
+
+	public:
+		static constexpr bool is_always_lock_free = std::atomic<node*>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
+		lock_free_stack()
+			: m_head{ nullptr }, m_is_active{ true }
+		{
+		}
+
+		lock_free_stack(std::initializer_list<_Ty>& init_list)
+			: lock_free_stack()
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				this->push_item(*it);
+				++it;
+			}
+		}
+
+		~lock_free_stack()
+		{
+			this->m_is_active = false;
+
+			node* item = this->m_head.exchange(nullptr);
+
+			while (item)
+			{
+				node* const next = item->m_next;
+				delete item;
+
+				item = next;
+			}
+		}
+
+		lock_free_stack(const lock_free_stack&) = delete;
+		lock_free_stack& operator=(const lock_free_stack&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			if (this->m_is_active)
+			{
+				this->push_item(data);
+				res = true;
+
+				return;
+			}
+
+			res = false;
+		}
+
+		std::shared_ptr<_Ty> pop()
+		{
+			using namespace std;
+
+			if (this->m_is_active)
+				return this->pop_item();
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			using namespace std;
+
+			guard reclaimer_guard(this->m_reclaimer);
+
+			int i = 0;
+			node* item = this->m_head.exchange(nullptr);
+
+			while (item)
+			{
+				node* const next = item->m_next;
+
+				shared_ptr<_Ty> data_ptr;
+				data_ptr.swap(item->m_data_ptr);
+
+				reclaimer_guard.retire(item);
+
+				item = next;
+				++i;
+			}
+
+			return i;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		void push_item(const _Ty& data)
+		{
+			_Backoff backoff;
+
+			node* const item = new node(data);
+			item->m_next = this->m_head.load();
+
+			while (!m_head.compare_exchange_weak(item->m_next, item))
+			{
+				if (this->m_elimination.try_push(item))
+					return;
+
+				backoff();
+			}
+		}
+
+		std::shared_ptr<_Ty> pop_item()
+		{
+			using namespace std;
+
+			guard reclaimer_guard(this->m_reclaimer);
+			_Backoff backoff;
+			node* item;
+
+			for (;;)
+			{
+				item = reclaimer_guard.protect(0, this->m_head);
+
+				if (!item || this->m_head.compare_exchange_strong(item, item->m_next))
+					break;
+
+				// the exchanged node was never linked into the stack, so it bypasses the reclaimer
+				if (node* const exchanged = this->m_elimination.try_pop())
+				{
+					shared_ptr<_Ty> res;
+					res.swap(exchanged->m_data_ptr);
+					delete exchanged;
+
+					return res;
+				}
+
+				backoff();
+			}
+
+			shared_ptr<_Ty> res;
+
+			if (item)
+			{
+				res.swap(item->m_data_ptr);
+				reclaimer_guard.retire(item);
+			}
+
+			return res;
+		}
+
+		std::atomic<node*> m_head;
+		_Reclaimer m_reclaimer;
+		elimination m_elimination;
+		std::atomic<bool> m_is_active;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "lock_free_stack.h"
+
+// the Treiber stack with epoch-based reclamation, kept under its own name for existing users
+template<typename _Ty, typename _Backoff = no_backoff> using lock_free_stack_epoch = lock_free_stack<_Ty, epoch_reclaimer, _Backoff>;
@@ -2,10 +2,18 @@
 
 #include <atomic>
 #include <memory>
+#include <type_traits>
 #include <initializer_list>
 
-template<typename _Ty> class lock_free_stack_pop_count
+#include "elimination_array.h"
+#include "backoff.h"
+
+template<typename _Ty, int max_pending_nodes = 1024, bool use_elimination = false, typename _Backoff = no_backoff>
+class lock_free_stack_pop_count
 {
+	static constexpr int generation_shift = 16;
+	static constexpr int generation_mask  = (1 << generation_shift) - 1;
+
 	class node
 	{
 		public:
@@ -18,10 +26,22 @@ template<typename _Ty> class lock_free_stack_pop_count
 			node* m_next;
 	};
 
+	using elimination = typename std::conditional<use_elimination, elimination_array<node>, no_elimination_array<node>>::type;
+
 	public:
+		// the pending list is sealed once it holds this many nodes, poppers wait once it holds twice as many
+		static constexpr int pending_nodes_limit = max_pending_nodes;
+
+		static constexpr bool is_always_lock_free =
+			std::atomic<node*>::is_always_lock_free &&
+			std::atomic<int>::is_always_lock_free &&
+			std::atomic<bool>::is_always_lock_free;
+
 		lock_free_stack_pop_count()
-			: m_head{ nullptr }, m_nodes_to_delete{ nullptr }, m_is_active{ true }, m_pop_counter{ 0 }
+			: m_head{ nullptr }, m_nodes_to_delete{ nullptr }, m_sealed_nodes{ nullptr }, m_pending_counter{ 0 }, m_sealed_counter{ 0 },
+			  m_pop_counter{ 0 }, m_generation{ 0 }, m_sealed_generation{ 0 }, m_is_sealing{ false }, m_is_active{ true }
 		{
+			static_assert(max_pending_nodes > 0, "max_pending_nodes must be positive");
 		}
 	
 		lock_free_stack_pop_count(std::initializer_list<_Ty>& init_list)
@@ -45,15 +65,9 @@ template<typename _Ty> class lock_free_stack_pop_count
 			this->m_is_active.store(false);
 			while (this->m_pop_counter.load());
 
-			node* nodes = this->m_head.exchange(nullptr);
-	
-			if (nodes)
-			{
-				this->add_pending_nodes(nodes);
-				nodes = nullptr;
-			}
-	
+			lock_free_stack_pop_count::delete_nodes(this->m_head.exchange(nullptr));
 			lock_free_stack_pop_count::delete_nodes(this->m_nodes_to_delete);
+			lock_free_stack_pop_count::delete_nodes(this->m_sealed_nodes);
 		}
 	
 		lock_free_stack_pop_count(const lock_free_stack_pop_count&) = delete;
@@ -69,9 +83,18 @@ template<typename _Ty> class lock_free_stack_pop_count
 				return;
 			}
 
+			_Backoff backoff;
+
 			node* const item = new node(move(data));
 			item->m_next = this->m_head.load();
-			while (!m_head.compare_exchange_weak(item->m_next, item));
+
+			while (!m_head.compare_exchange_weak(item->m_next, item))
+			{
+				if (this->m_elimination.try_push(item))
+					break;
+
+				backoff();
+			}
 
 			res = true;
 		}
@@ -83,19 +106,38 @@ template<typename _Ty> class lock_free_stack_pop_count
 			if (!this->m_is_active)
 				return shared_ptr<_Ty>();
 
-			this->m_pop_counter.fetch_add(1);
+			const int generation = this->m_generation.load();
+			this->m_pop_counter.fetch_add(1 << (generation * generation_shift));
 	
+			_Backoff backoff;
+
 			node* item = this->m_head.load();
-			while (item && !this->m_head.compare_exchange_weak(item, item->m_next));
+			node* exchanged = nullptr;
+
+			while (item && !this->m_head.compare_exchange_weak(item, item->m_next))
+			{
+				if ((exchanged = this->m_elimination.try_pop()) != nullptr)
+					break;
+
+				backoff();
+			}
 	
 			shared_ptr<_Ty> res;
 	
-			if (item)
+			if (exchanged)
+			{
+				// the node came from a pusher and was never linked, nobody else can reach it
+				res.swap(exchanged->m_data_ptr);
+				delete exchanged;
+
+				item = nullptr;
+			}
+			else if (item)
 			{
 				res.swap(item->m_data_ptr);
 			}
 	
-			this->clean_up(item);
+			this->clean_up(item, generation);
 
 			return res;
 		}
@@ -124,7 +166,7 @@ template<typename _Ty> class lock_free_stack_pop_count
 					tail->m_data_ptr.reset();
 				}
 
-				this->add_pending_nodes(head, tail);
+				this->add_pending_nodes(head, tail, j);
 			}
 
 			return j;
@@ -134,8 +176,23 @@ template<typename _Ty> class lock_free_stack_pop_count
 		{
 			return this->m_is_active;
 		}
+
+		int pending_nodes() const
+		{
+			return this->m_pending_counter.load() + this->m_sealed_counter.load();
+		}
 	
 	private:
+		static int get_pop_count(int counter)
+		{
+			return (counter & generation_mask) + (counter >> generation_shift);
+		}
+
+		static int get_pop_count(int counter, int generation)
+		{
+			return (counter >> (generation * generation_shift)) & generation_mask;
+		}
+
 		static int delete_nodes(node* nodes)
 		{
 			int res = 0;
@@ -152,22 +209,24 @@ template<typename _Ty> class lock_free_stack_pop_count
 			return res;
 		}
 	
-		void clean_up(node* item)
+		void clean_up(node* item, int generation)
 		{
-			if (this->m_pop_counter == 1)
+			using namespace std;
+
+			if (lock_free_stack_pop_count::get_pop_count(this->m_pop_counter.load()) == 1)
 			{
 				node* nodes_to_delete = this->m_nodes_to_delete.exchange(nullptr);
 
-				if (this->m_pop_counter == 1)
+				if (lock_free_stack_pop_count::get_pop_count(this->m_pop_counter.load()) == 1)
 				{
-					lock_free_stack_pop_count::delete_nodes(nodes_to_delete);
+					this->m_pending_counter.fetch_sub(lock_free_stack_pop_count::delete_nodes(nodes_to_delete));
 				}
 				else if (nodes_to_delete)
 				{
-					this->add_pending_nodes(nodes_to_delete);
+					this->restore_pending_nodes(nodes_to_delete);
 				}
 
-				this->m_pop_counter.fetch_sub(1);
+				this->m_pop_counter.fetch_sub(1 << (generation * generation_shift));
 				delete item;
 
 				return;
@@ -178,10 +237,89 @@ template<typename _Ty> class lock_free_stack_pop_count
 				this->add_pending_node(item);
 			}
 	
-			this->m_pop_counter.fetch_sub(1);
+			this->m_pop_counter.fetch_sub(1 << (generation * generation_shift));
+
+			if (this->m_sealed_nodes.load(memory_order_relaxed) || this->m_pending_counter.load(memory_order_relaxed) >= max_pending_nodes)
+			{
+				this->seal_pending_nodes();
+			}
+
+			if (this->m_pending_counter.load() >= 2 * max_pending_nodes)
+			{
+				this->wait_for_sealed_generation();
+			}
+		}
+
+		// A popper preempted in the sealed generation holds back every later batch while the others keep retiring nodes.
+		// Past twice the limit a popper that has left stops and yields until the sealed batch is freed and the next one
+		// sealed, so at most about 2 * max_pending_nodes nodes are pending and as many sealed, plus one per popper.
+		// Pops block only in that case, the pop counter itself never waits.
+		void wait_for_sealed_generation()
+		{
+			yield_backoff<> backoff;
+
+			while (this->m_pending_counter.load() >= 2 * max_pending_nodes)
+			{
+				backoff();
+				this->seal_pending_nodes();
+			}
+		}
+
+		// Under constant overlap the pop counter never drops to one, so the fallback splits poppers into two generations.
+		// The pending list is sealed and new poppers are moved to the other generation. The sealed batch is freed once
+		// every popper of the old generation has left, since poppers arriving later can no longer reach its nodes.
+		void seal_pending_nodes()
+		{
+			bool is_sealing = false;
+
+			if (this->m_is_sealing.load() ||
+				!this->m_is_sealing.compare_exchange_strong(is_sealing, true))
+				return;
+
+			// the sealed list only changes under m_is_sealing
+			if (node* const sealed = this->m_sealed_nodes.load())
+			{
+				if (!lock_free_stack_pop_count::get_pop_count(this->m_pop_counter.load(), this->m_sealed_generation))
+				{
+					this->m_sealed_nodes.store(nullptr);
+					this->m_sealed_counter.fetch_sub(lock_free_stack_pop_count::delete_nodes(sealed));
+				}
+			}
+
+			const int generation = this->m_generation.load();
+
+			if (!this->m_sealed_nodes.load() && this->m_pending_counter.load() >= max_pending_nodes &&
+				!lock_free_stack_pop_count::get_pop_count(this->m_pop_counter.load(), generation ^ 1))
+			{
+				node* const nodes = this->m_nodes_to_delete.exchange(nullptr);
+
+				if (nodes && lock_free_stack_pop_count::get_pop_count(this->m_pop_counter.load(), generation ^ 1))
+				{
+					this->restore_pending_nodes(nodes);
+				}
+				else if (nodes)
+				{
+					int j = 1;
+
+					for (node* item = nodes; item->m_next; item = item->m_next)
+					{
+						++j;
+					}
+
+					this->m_pending_counter.fetch_sub(j);
+					this->m_sealed_counter.fetch_add(j);
+
+					this->m_sealed_generation = generation;
+					this->m_sealed_nodes.store(nodes);
+					this->m_generation.store(generation ^ 1);
+				}
+			}
+
+			this->m_is_sealing.store(false);
 		}
 	
-		void add_pending_nodes(node* head)
+		// puts back a list taken from m_nodes_to_delete, its nodes are still counted in m_pending_counter
+		void restore_pending_nodes(node* head)
 		{
 			node* tail = head;
 	
@@ -190,22 +328,39 @@ template<typename _Ty> class lock_free_stack_pop_count
 				tail = next;
 			}
 	
-			this->add_pending_nodes(head, tail);
+			this->link_pending_nodes(head, tail);
 		}
 	
-		void add_pending_nodes(node* head, node* tail)
+		void add_pending_nodes(node* head, node* tail, int count)
 		{
-			tail->m_next = this->m_nodes_to_delete;
-			while (!this->m_nodes_to_delete.compare_exchange_weak(tail->m_next, head));
+			this->m_pending_counter.fetch_add(count);
+			this->link_pending_nodes(head, tail);
+		}
+
+		void link_pending_nodes(node* head, node* tail)
+		{
+			_Backoff backoff;
+
+			tail->m_next = this->m_nodes_to_delete.load();
+
+			while (!this->m_nodes_to_delete.compare_exchange_weak(tail->m_next, head))
+				backoff();
 		}
 	
 		void add_pending_node(node* item)
 		{
-			this->add_pending_nodes(item, item);
+			this->add_pending_nodes(item, item, 1);
 		}
 
 		std::atomic<node*> m_head;
 		std::atomic<node*> m_nodes_to_delete;
+		std::atomic<node*> m_sealed_nodes;
+		std::atomic<int>   m_pending_counter;
+		std::atomic<int>   m_sealed_counter;
 		std::atomic<int>   m_pop_counter;
+		std::atomic<int>   m_generation;
+		int                m_sealed_generation;
+		std::atomic<bool>  m_is_sealing;
 		std::atomic<bool>  m_is_active;
+		elimination        m_elimination;
 };
@@ -4,7 +4,9 @@
 #include <memory>
 #include <initializer_list>
 
-template<typename _Ty> class lock_free_stack_ref_count
+#include "backoff.h"
+
+template<typename _Ty, typename _Backoff = no_backoff> class lock_free_stack_ref_count
 {
 	private:
 		struct node;
@@ -34,6 +36,8 @@ template<typename _Ty> class lock_free_stack_ref_count
 		};
 
 	public:
+		static constexpr bool is_always_lock_free = std::atomic<counted_node_ptr>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
 		lock_free_stack_ref_count()
 			: m_is_active { true }
 		{
@@ -107,18 +111,23 @@ template<typename _Ty> class lock_free_stack_ref_count
 		{
 			using namespace std;
 
+			_Backoff backoff;
+
 			counted_node_ptr item;
 			item.m_node = new node(data);
 			item.m_external_counter = 1;
 			item.m_node->m_next = this->m_head.load(memory_order_relaxed);
+
 			while (!this->m_head.compare_exchange_weak(
-				item.m_node->m_next, item, memory_order_release, memory_order_relaxed));
+				item.m_node->m_next, item, memory_order_release, memory_order_relaxed))
+				backoff();
 		}
 
 		std::shared_ptr<_Ty> pop_item()
 		{
 			using namespace std;
 
+			_Backoff backoff;
 			counted_node_ptr old_head = this->m_head.load(memory_order_relaxed);
 
 			for(;;)
@@ -149,6 +158,8 @@ template<typename _Ty> class lock_free_stack_ref_count
 					p_node->m_internal_counter.load(memory_order_acquire);
 					delete p_node;
 				}
+
+				backoff();
 			}
 		}
 
@@ -156,14 +167,20 @@ template<typename _Ty> class lock_free_stack_ref_count
 		{
 			using namespace std;
 
+			_Backoff backoff;
 			counted_node_ptr new_counter;
 
-			do
+			for (;;)
 			{
 				new_counter = old_counter;
 				++new_counter.m_external_counter;
-			} while (!this->m_head.compare_exchange_strong(
-				old_counter, new_counter, memory_order_acquire, memory_order_relaxed));
+
+				if (this->m_head.compare_exchange_strong(
+					old_counter, new_counter, memory_order_acquire, memory_order_relaxed))
+					break;
+
+				backoff();
+			}
 
 			old_counter.m_external_counter = new_counter.m_external_counter;
 		}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <initializer_list>
+
+#include "tagged_ptr.h"
+#include "backoff.h"
+
+// lock_free_stack_ref_count with the external counter packed into the upper bits of the head pointer,
+// so every CAS is on a single 8-byte word instead of a 16-byte counted_node_ptr.
+//
+// A popper that loses to a push takes its count back from the node's internal counter, but its increment stays in the
+// tag saved in the pushed node's m_next and comes back when that node is popped. So the tag grows over every period
+// the node spends at the head and would wrap the 16-bit field. The borrower that takes it past fold_threshold moves all
+// counts but the link's and its own into the internal counter. That counter starts at unpopped_bias and the popper
+// removes the bias, so the moved counts cannot bring it to zero before the node is popped.
+template<typename _Ty, typename _Backoff = no_backoff> class lock_free_stack_ref_count_tagged
+{
+	private:
+		class node;
+
+		using counted_node_ptr = tagged_ptr<node>;
+
+		static constexpr int      unpopped_bias  = 1 << 30;
+		static constexpr unsigned fold_threshold = 1u << 14;
+
+		static_assert(fold_threshold < counted_node_ptr::max_tag, "the tag must have room above the fold threshold");
+
+		class node
+		{
+			public:
+				node(const _Ty& data)
+					: m_data{ std::make_shared<_Ty>(data) }, m_internal_counter{ unpopped_bias }
+				{
+				}
+
+				std::shared_ptr<_Ty> m_data;
+				std::atomic<int>     m_internal_counter;
+				counted_node_ptr     m_next;
+		};
+
+	public:
+		static constexpr bool is_always_lock_free =
+			std::atomic<counted_node_ptr>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+
+		static_assert(is_always_lock_free, "the tagged head must be a single-word atomic");
+
+		lock_free_stack_ref_count_tagged()
+			: m_is_active { true }
+		{
+		}
+
+		lock_free_stack_ref_count_tagged(std::initializer_list<_Ty>& init_list)
+			: lock_free_stack_ref_count_tagged()
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				this->push_item(*it);
+				++it;
+			}
+		}
+
+		~lock_free_stack_ref_count_tagged()
+		{
+			this->m_is_active.store(false);
+			while (this->pop_item());
+		}
+
+		lock_free_stack_ref_count_tagged(const lock_free_stack_ref_count_tagged&) = delete;
+		lock_free_stack_ref_count_tagged& operator=(const lock_free_stack_ref_count_tagged&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			if (this->m_is_active)
+			{
+				this->push_item(data);
+				res = true;
+
+				return;
+			}
+
+			res = false;
+		}
+
+		std::shared_ptr<_Ty> pop()
+		{
+			using namespace std;
+
+			if (this->m_is_active)
+				return this->pop_item();
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			int j = 0;
+
+			while (this->pop())
+			{
+				++j;
+			}
+
+			return j;
+		}
+
+		bool is_active()
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		void push_item(const _Ty& data)
+		{
+			using namespace std;
+
+			_Backoff backoff;
+
+			const counted_node_ptr item(new node(data), 1);
+			item.get_ptr()->m_next = this->m_head.load(memory_order_relaxed);
+
+			while (!this->m_head.compare_exchange_weak(
+				item.get_ptr()->m_next, item, memory_order_release, memory_order_relaxed))
+				backoff();
+		}
+
+		std::shared_ptr<_Ty> pop_item()
+		{
+			using namespace std;
+
+			_Backoff backoff;
+			counted_node_ptr old_head = this->m_head.load(memory_order_relaxed);
+
+			for(;;)
+			{
+				this->increase_head_count(old_head);
+				node* const p_node = old_head.get_ptr();
+
+				if (!p_node)
+					return shared_ptr<_Ty>();
+
+				// a failed CAS that only saw other poppers' increments or a fold keeps our count on the node and retries
+				while (!this->m_head.compare_exchange_strong(
+					old_head, p_node->m_next, memory_order_relaxed))
+				{
+					if (old_head.get_ptr() != p_node)
+						break;
+
+					backoff();
+				}
+
+				if (old_head.get_ptr() == p_node)
+				{
+					shared_ptr<_Ty> res;
+					res.swap(p_node->m_data);
+
+					const int inc = static_cast<int>(old_head.get_tag()) - 2 - unpopped_bias;
+
+					if (p_node->m_internal_counter.fetch_add(inc, memory_order_release) == -inc)
+					{
+						delete p_node;
+					}
+
+					return res;
+				}
+
+				lock_free_stack_ref_count_tagged::release_count(p_node);
+				backoff();
+			}
+		}
+
+		// gives back the count of a popper that lost the node to another thread
+		static void release_count(node* p_node)
+		{
+			using namespace std;
+
+			if (p_node->m_internal_counter.fetch_add(-1, memory_order_relaxed) == 1)
+			{
+				p_node->m_internal_counter.load(memory_order_acquire);
+				delete p_node;
+			}
+		}
+
+		void increase_head_count(counted_node_ptr& old_counter)
+		{
+			using namespace std;
+
+			_Backoff backoff;
+			counted_node_ptr new_counter;
+
+			for (;;)
+			{
+				// an empty stack has nothing to protect, and counting on it would only wrap the tag
+				if (!old_counter.get_ptr())
+					return;
+
+				if (old_counter.get_tag() == counted_node_ptr::max_tag)
+				{
+					// saturated, wait for a borrower past fold_threshold to move the counts into the node
+					this_thread::yield();
+					old_counter = this->m_head.load(memory_order_relaxed);
+
+					continue;
+				}
+
+				new_counter = counted_node_ptr(old_counter.get_ptr(), old_counter.get_tag() + 1);
+
+				if (this->m_head.compare_exchange_strong(
+					old_counter, new_counter, memory_order_acquire, memory_order_relaxed))
+					break;
+
+				backoff();
+			}
+
+			old_counter = new_counter;
+
+			if (new_counter.get_tag() >= fold_threshold)
+			{
+				this->fold_head_count(old_counter);
+			}
+		}
+
+		// our own count keeps the node alive, and the internal counter is raised before the tag drops,
+		// so the node's total count never dips below its real value
+		void fold_head_count(counted_node_ptr& old_counter)
+		{
+			using namespace std;
+
+			node* const p_node = old_counter.get_ptr();
+			counted_node_ptr current = old_counter;
+
+			for (;;)
+			{
+				const int surplus = static_cast<int>(current.get_tag()) - 2;
+				const counted_node_ptr folded(p_node, 2);
+
+				p_node->m_internal_counter.fetch_add(surplus, memory_order_relaxed);
+
+				if (this->m_head.compare_exchange_strong(current, folded, memory_order_acquire, memory_order_relaxed))
+				{
+					old_counter = folded;
+					return;
+				}
+
+				p_node->m_internal_counter.fetch_add(-surplus, memory_order_relaxed);
+
+				// the node has left the head, the caller's CAS fails on old_counter and gives its count back
+				if (current.get_ptr() != p_node)
+					return;
+
+				old_counter = current;
+
+				if (current.get_tag() < fold_threshold)
+					return;
+			}
+		}
+
+		std::atomic<counted_node_ptr> m_head;
+		std::atomic<bool>			  m_is_active;
+};
@@ -2,110 +2,432 @@
 
 #include <initializer_list>
 #include <iostream>
+#include <string>
 #include <thread>
 
 #include "concurrent_stack.h"
 #include "concurrent_queue.h"
 #include "concurrent_queue_fast.h"
+#include "concurrent_queue_segmented.h"
 #include "concurrent_map.h"
+#include "bravo_shared_mutex.h"
 #include "concurrent_list.h"
 
 #include "lock_free_stack_pop_count.h"
 #include "lock_free_stack_hp.h"
 #include "lock_free_stack_ref_count.h"
+#include "lock_free_stack_ref_count_tagged.h"
+#include "lock_free_stack_epoch.h"
 #include "lock_free_queue_ref_count.h"
+#include "lock_free_queue_hp.h"
+#include "lock_free_queue_faa.h"
+#include "lock_free_queue_epoch.h"
+#include "lock_free_stack.h"
+#include "lock_free_queue.h"
+#include "wait_free_queue.h"
+#include "lock_free_queue_bounded.h"
+#include "lock_free_queue_spsc.h"
+#include "lock_free_map.h"
 #include "exp_stack_atomic_shared_ptr.h"
 
+#include "benchmark.h"
+
 #define stop __asm nop
 
-int main()
+template<typename _Container> void report_lock_free(const char* name)
+{
+	printf("%-48s is_always_lock_free = %s\n", name, _Container::is_always_lock_free ? "true" : "false");
+}
+
+// a container whose atomics are not always lock-free falls back to the locks of libatomic
+void report_lock_free_containers()
+{
+	report_lock_free<lock_free_stack_pop_count<int>>("lock_free_stack_pop_count");
+	report_lock_free<lock_free_stack_hp<int>>("lock_free_stack_hp");
+	report_lock_free<lock_free_stack_ref_count<int>>("lock_free_stack_ref_count");
+	report_lock_free<lock_free_stack_ref_count_tagged<int>>("lock_free_stack_ref_count_tagged");
+	report_lock_free<lock_free_stack_epoch<int>>("lock_free_stack_epoch");
+	report_lock_free<lock_free_stack<int>>("lock_free_stack");
+	report_lock_free<lock_free_queue_ref_count<int>>("lock_free_queue_ref_count");
+	report_lock_free<lock_free_queue_hp<int>>("lock_free_queue_hp");
+	report_lock_free<lock_free_queue_faa<int>>("lock_free_queue_faa");
+	report_lock_free<lock_free_queue_epoch<int>>("lock_free_queue_epoch");
+	report_lock_free<lock_free_queue<int>>("lock_free_queue");
+	report_lock_free<lock_free_queue_bounded<int>>("lock_free_queue_bounded");
+	report_lock_free<lock_free_queue_spsc<int>>("lock_free_queue_spsc");
+	report_lock_free<lock_free_map<int, int>>("lock_free_map");
+	report_lock_free<wait_free_queue<int>>("wait_free_queue");
+	report_lock_free<exp_stack_atomic_shared_ptr<int, shared_ptr_free_functions>>("exp_stack_atomic_shared_ptr<free_functions>");
+	report_lock_free<exp_stack_atomic_shared_ptr<int, shared_ptr_split_count>>("exp_stack_atomic_shared_ptr<split_count>");
+#if defined(__cpp_lib_atomic_shared_ptr)
+	report_lock_free<exp_stack_atomic_shared_ptr<int, shared_ptr_std_atomic>>("exp_stack_atomic_shared_ptr<std_atomic>");
+#endif
+}
+
+void benchmark_queues(long chunk)
 {
 	using namespace std;
 
+	for (int threads : { 1, 2, 4, 8 })
 	{
-		int len = 5;
-		long chunk = 1 * 1000000;
+		{
+			concurrent_queue_fast<int> queue;
+			benchmark_queue("concurrent_queue_fast", queue, threads, threads, chunk);
+		}
+
+		{
+			concurrent_queue_segmented<int> queue;
+			benchmark_queue("concurrent_queue_segmented", queue, threads, threads, chunk);
+		}
 
-		initializer_list<int> init_list{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-		lock_free_queue_ref_count<int> myBag(init_list);
+		{
+			lock_free_queue_ref_count<int> queue;
+			benchmark_queue("lock_free_queue_ref_count", queue, threads, threads, chunk);
+		}
 
-		auto reader = [&](double d)->void
 		{
-			printf("reader_%i: started\n", this_thread::get_id());
+			lock_free_queue_bounded<int> queue(64 * 1024);
+			benchmark_queue("lock_free_queue_bounded", queue, threads, threads, chunk);
+		}
 
-			long i = 0;
-			long n = d * len * chunk;
+		{
+			concurrent_queue_fast<int> queue;
+			benchmark_queue_bulk("concurrent_queue_fast (bulk)", queue, threads, threads, chunk, 64);
+		}
 
-			while (n)
-			{
-				if (!myBag.is_active())
-					break;
+		if (threads == 1)
+		{
+			lock_free_queue_spsc<int> queue(64 * 1024);
+			benchmark_queue("lock_free_queue_spsc", queue, threads, threads, chunk);
+		}
+	}
+}
 
-				shared_ptr<int> res = myBag.pop();
+void benchmark_queue_scaling(long chunk)
+{
+	using namespace std;
+
+	for (int writers : { 1, 4 })
+	{
+		for (int readers : { 1, 4, 8 })
+		{
+			// the single-lock queue is the baseline where producers and consumers serialize on one mutex
+			{
+				concurrent_queue<int> queue;
+				benchmark_queue("concurrent_queue", queue, writers, readers, chunk);
+			}
 
-				if (res)
-				{
-					--n;
-					++i;
-				}
+			{
+				concurrent_queue_fast<int> queue;
+				benchmark_queue("concurrent_queue_fast", queue, writers, readers, chunk);
 			}
+		}
+	}
+}
+
+void benchmark_lock_free_queues(long chunk)
+{
+	using namespace std;
+
+	for (int threads : { 1, 2, 4, 8, 16, 32, 64 })
+	{
+		const int  writers = threads > 1 ? threads / 2 : 1;
+		const int  readers = threads > 1 ? threads / 2 : 1;
+		const long items   = chunk / writers;
+
+		{
+			lock_free_queue_ref_count<int> queue;
+			benchmark_queue("lock_free_queue_ref_count", queue, writers, readers, items);
+		}
+
+		{
+			lock_free_queue_hp<int> queue;
+			benchmark_queue("lock_free_queue_hp", queue, writers, readers, items);
+		}
+
+		{
+			lock_free_queue_faa<int> queue;
+			benchmark_queue("lock_free_queue_faa", queue, writers, readers, items);
+		}
+	}
+}
+
+void benchmark_reclamation(long chunk)
+{
+	using namespace std;
+
+	for (int threads : { 1, 2, 4, 8 })
+	{
+		{
+			lock_free_stack_pop_count<int> stack;
+			benchmark_queue("lock_free_stack_pop_count", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_hp<int> stack;
+			benchmark_queue("lock_free_stack_hp", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_ref_count<int> stack;
+			benchmark_queue("lock_free_stack_ref_count", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_ref_count_tagged<int> stack;
+			benchmark_queue("lock_free_stack_ref_count_tagged", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_epoch<int> stack;
+			benchmark_queue("lock_free_stack_epoch", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_queue_ref_count<int> queue;
+			benchmark_queue("lock_free_queue_ref_count", queue, threads, threads, chunk);
+		}
 
-			printf("reader_%i: ended, i = %i\n", this_thread::get_id(), i);
-		};
+		{
+			lock_free_queue_hp<int> queue;
+			benchmark_queue("lock_free_queue_hp", queue, threads, threads, chunk);
+		}
 
-		auto writer = [&](int value)->void
 		{
-			long n = chunk;
+			lock_free_queue_epoch<int> queue;
+			benchmark_queue("lock_free_queue_epoch", queue, threads, threads, chunk);
+		}
+	}
+
+	// many readers keep the pop counter above one, so only sealing bounds the retired nodes
+	for (int readers : { 4, 8, 16 })
+	{
+		lock_free_stack_pop_count<int> stack;
+		benchmark_pending_nodes("lock_free_stack_pop_count", stack, 2, readers, chunk);
+	}
+}
+
+template<typename _Reclaimer> void benchmark_reclaimer(const char* stack_name, const char* queue_name, int threads, long chunk)
+{
+	{
+		lock_free_stack<int, _Reclaimer> stack;
+		benchmark_queue(stack_name, stack, threads, threads, chunk);
+	}
+
+	{
+		lock_free_queue<int, _Reclaimer> queue;
+		benchmark_queue(queue_name, queue, threads, threads, chunk);
+	}
+}
+
+void benchmark_reclaimers(long chunk)
+{
+	using namespace std;
 
-			printf("writer_%i: started, n = %i\n", this_thread::get_id(), n);
+	for (int threads : { 1, 2, 4, 8 })
+	{
+		benchmark_reclaimer<pop_count_reclaimer<>>("lock_free_stack<pop_count>", "lock_free_queue<pop_count>", threads, chunk);
+		benchmark_reclaimer<hazard_pointer_reclaimer>("lock_free_stack<hazard_pointer>", "lock_free_queue<hazard_pointer>", threads, chunk);
+		benchmark_reclaimer<epoch_reclaimer>("lock_free_stack<epoch>", "lock_free_queue<epoch>", threads, chunk);
+		benchmark_reclaimer<leak_reclaimer<>>("lock_free_stack<leak>", "lock_free_queue<leak>", threads, chunk);
+	}
+}
 
-			while (n)
+void benchmark_atomic_shared_ptr(long chunk)
+{
+	using namespace std;
+
+	for (int threads : { 1, 2, 4, 8 })
+	{
+		{
+			exp_stack_atomic_shared_ptr<int, shared_ptr_free_functions> stack;
+			benchmark_queue("exp_stack_atomic_shared_ptr<free_functions>", stack, threads, threads, chunk);
+		}
+
+		{
+			exp_stack_atomic_shared_ptr<int, shared_ptr_split_count> stack;
+			benchmark_queue("exp_stack_atomic_shared_ptr<split_count>", stack, threads, threads, chunk);
+		}
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+		{
+			exp_stack_atomic_shared_ptr<int, shared_ptr_std_atomic> stack;
+			benchmark_queue("exp_stack_atomic_shared_ptr<std_atomic>", stack, threads, threads, chunk);
+		}
+#endif
+	}
+}
+
+void benchmark_elimination(long chunk)
+{
+	using namespace std;
+
+	for (int threads : { 1, 2, 4, 8, 16 })
+	{
+		{
+			lock_free_stack_hp<int> stack;
+			benchmark_queue("lock_free_stack_hp", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_hp<int, true> stack;
+			benchmark_queue("lock_free_stack_hp<elimination>", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_pop_count<int> stack;
+			benchmark_queue("lock_free_stack_pop_count", stack, threads, threads, chunk);
+		}
+
+		{
+			lock_free_stack_pop_count<int, 1024, true> stack;
+			benchmark_queue("lock_free_stack_pop_count<elimination>", stack, threads, threads, chunk);
+		}
+	}
+}
+
+template<typename _Backoff> void benchmark_backoff(const char* name, int threads, long chunk)
+{
+	using namespace std;
+
+	const string suffix = string("<") + name + ">";
+
+	{
+		lock_free_stack_hp<int, false, _Backoff> stack;
+		benchmark_queue(("lock_free_stack_hp" + suffix).c_str(), stack, threads, threads, chunk);
+	}
+
+	{
+		lock_free_stack_ref_count_tagged<int, _Backoff> stack;
+		benchmark_queue(("lock_free_stack_ref_count_tagged" + suffix).c_str(), stack, threads, threads, chunk);
+	}
+
+	{
+		lock_free_queue_ref_count<int, _Backoff> queue;
+		benchmark_queue(("lock_free_queue_ref_count" + suffix).c_str(), queue, threads, threads, chunk);
+	}
+}
+
+// writers plus readers make one and two threads per core
+void benchmark_backoffs(long chunk)
+{
+	using namespace std;
+
+	const int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+
+	for (int threads : { max(1, cores / 2), cores })
+	{
+		benchmark_backoff<no_backoff>("no_backoff", threads, chunk);
+		benchmark_backoff<spin_backoff>("spin", threads, chunk);
+		benchmark_backoff<exponential_backoff<>>("exponential", threads, chunk);
+		benchmark_backoff<yield_backoff<>>("yield", threads, chunk);
+	}
+}
+
+// the fill phase grows every shard's table many times over, the mixes then run on a table that keeps resizing
+// as removes and inserts move the size across its load factor
+void benchmark_maps(long chunk)
+{
+	using namespace std;
+
+	const int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+
+	for (int threads : { 1, cores, 2 * cores })
+	{
+		for (int read_percent : { 90, 99 })
+		{
 			{
-				if (!myBag.is_active())
-					break;
+				concurrent_map<int, int> map;
+				benchmark_map("concurrent_map<chained>", map, threads, static_cast<int>(chunk), read_percent, chunk / threads);
+			}
 
-				bool res = false;
-				myBag.push(value, res);
+			{
+				concurrent_map<int, int, hash<int>, 17, flat_storage> map;
+				benchmark_map("concurrent_map<flat>", map, threads, static_cast<int>(chunk), read_percent, chunk / threads);
+			}
 
-				--n;
+			{
+				lock_free_map<int, int> map;
+				benchmark_map("lock_free_map", map, threads, static_cast<int>(chunk), read_percent, chunk / threads);
 			}
+		}
+	}
+}
 
-			printf("writer_%i: ended, n = %i\n", this_thread::get_id(), n);
-		};
+// few keys, so readers keep meeting on the same shard locks
+void benchmark_map_locks(long chunk)
+{
+	using namespace std;
 
-		vector<thread> th_writers;
-		vector<thread> th_readers;
+	const int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
+	const int keys = 1024;
 
-		for (int i = 0; i < len; i++)
+	for (int threads : { 1, cores, 2 * cores })
+	{
+		for (int read_percent : { 90, 99, 100 })
 		{
-			th_writers.push_back(thread(writer, i));
+			{
+				concurrent_map<int, int> map;
+				benchmark_map("concurrent_map<shared_mutex>", map, threads, keys, read_percent, chunk / threads);
+			}
+
+			{
+				concurrent_map<int, int, hash<int>, 17, chained_storage, bravo_shared_mutex<>> map;
+				benchmark_map("concurrent_map<bravo_shared_mutex>", map, threads, keys, read_percent, chunk / threads);
+			}
 		}
+	}
+}
+
+void benchmark_queue_latencies(long chunk)
+{
+	using namespace std;
+
+	const int cores = static_cast<int>(max(1u, thread::hardware_concurrency()));
 
-		this_thread::sleep_for(1s);
-		
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
-		th_readers.push_back(thread(reader, 0.1));
+	for (int threads : { cores, 2 * cores, 4 * cores })
+	{
+		const long ops = chunk / threads;
 
-		for (auto& th : th_writers)
 		{
-			th.join();
+			lock_free_queue_ref_count<int> queue;
+			benchmark_queue_latency("lock_free_queue_ref_count", queue, threads, ops);
 		}
 
-		for (auto& th : th_readers)
 		{
-			th.join();
+			// the queue has a fixed number of thread slots and throws when a thread finds none free
+			const int wait_free_threads = min(threads, wait_free_queue<int>::max_num_of_threads);
+
+			if (wait_free_threads < threads)
+			{
+				printf("wait_free_queue: %d threads clamped to %d thread slots\n", threads, wait_free_threads);
+			}
+
+			wait_free_queue<int> queue;
+			benchmark_queue_latency("wait_free_queue", queue, wait_free_threads, chunk / wait_free_threads);
 		}
+	}
+}
+
+int main()
+{
+	using namespace std;
+
+	{
+		long chunk = 1 * 1000000;
 
-		int k = myBag.clear();
-		printf("k = %i\n", k);
+		report_lock_free_containers();
+		benchmark_queues(chunk);
+		benchmark_queue_scaling(chunk);
+		benchmark_lock_free_queues(chunk);
+		benchmark_reclamation(chunk);
+		benchmark_reclaimers(chunk);
+		benchmark_atomic_shared_ptr(chunk);
+		benchmark_elimination(chunk);
+		benchmark_backoffs(chunk);
+		benchmark_maps(chunk);
+		benchmark_map_locks(chunk);
+		benchmark_queue_latencies(chunk);
 
 		stop
 	}
@@ -0,0 +1,709 @@
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <cstddef>
+#include <new>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Storage policies for the tables behind concurrent_map's lock stripes. The map creates one
+// _Storage::table<_Key, _Val, _Hash> per stripe and writes to it only under the stripe's lock. A table that sets
+// optimistic_reads also allows find() without the lock, racing with a writer whose changes the map detects.
+// Both tables grow incrementally: a resize only allocates the new array and every later write moves
+// a few entries over, so no single operation pays for the whole rehash.
+
+// A chain of heap nodes per bucket, the chain array doubles when the load factor is exceeded.
+class chained_storage
+{
+	public:
+		template<typename _Key, typename _Val, typename _Hash> class table
+		{
+			static constexpr std::size_t initial_chains  = 8;
+			static constexpr std::size_t max_load_factor = 1;
+			static constexpr std::size_t migration_step  = 4;
+
+			class node
+			{
+				public:
+					node(const _Key& key, const _Val& value, std::size_t hash)
+						: m_item{ key, value }, m_hash{ hash }, m_next{ nullptr }
+					{
+					}
+
+					std::pair<_Key, _Val> m_item;
+					std::size_t           m_hash;
+					node*                 m_next;
+			};
+
+			public:
+				// erase frees nodes that a reader without the lock could still be walking
+				static constexpr bool optimistic_reads = false;
+
+				// nodes cache their hash, so the hasher is not needed to move them
+				table(const _Hash&)
+					: m_chains(initial_chains, nullptr), m_migrated{ 0 }, m_size{ 0 }
+				{
+				}
+
+				~table()
+				{
+					table::delete_chains(this->m_chains);
+					table::delete_chains(this->m_old_chains);
+				}
+
+				table(const table&) = delete;
+				table& operator=(const table&) = delete;
+
+				const _Val* find(const _Key& key, std::size_t hash) const
+				{
+					// during a resize the key is either still in its old chain or already in the new one
+					if (!this->m_old_chains.empty())
+					{
+						if (const node* const item = table::find_node(this->m_old_chains, key, hash))
+							return &item->m_item.second;
+					}
+
+					const node* const item = table::find_node(this->m_chains, key, hash);
+					return item ? &item->m_item.second : nullptr;
+				}
+
+				bool insert_or_assign(const _Key& key, std::size_t hash, const _Val& value)
+				{
+					this->prepare_write(hash);
+
+					if (node* const item = table::find_node(this->m_chains, key, hash))
+					{
+						item->m_item.second = value;
+						return false;
+					}
+
+					node*& chain = this->m_chains[hash % this->m_chains.size()];
+					node* const item = new node(key, value, hash);
+
+					item->m_next = chain;
+					chain = item;
+
+					if (++this->m_size > max_load_factor * this->m_chains.size() && this->m_old_chains.empty())
+					{
+						this->start_resize();
+					}
+
+					return true;
+				}
+
+				bool erase(const _Key& key, std::size_t hash)
+				{
+					this->prepare_write(hash);
+
+					for (node** link = &this->m_chains[hash % this->m_chains.size()]; *link; link = &(*link)->m_next)
+					{
+						node* const item = *link;
+
+						if (item->m_hash == hash && item->m_item.first == key)
+						{
+							*link = item->m_next;
+							delete item;
+
+							--this->m_size;
+							return true;
+						}
+					}
+
+					return false;
+				}
+
+				template<typename _Fn> void for_each(_Fn fn) const
+				{
+					table::for_each_node(this->m_old_chains, fn);
+					table::for_each_node(this->m_chains, fn);
+				}
+
+				int clear()
+				{
+					const int res = static_cast<int>(this->m_size);
+
+					table::delete_chains(this->m_chains);
+					table::delete_chains(this->m_old_chains);
+
+					std::vector<node*>().swap(this->m_old_chains);
+					this->m_migrated = 0;
+					this->m_size = 0;
+
+					return res;
+				}
+
+			private:
+				// the key's own old chain moves first, so the write below only has to look at the new chains
+				void prepare_write(std::size_t hash)
+				{
+					if (this->m_old_chains.empty())
+						return;
+
+					this->migrate_chain(hash % this->m_old_chains.size());
+
+					for (std::size_t i = 0; i < migration_step && this->m_migrated < this->m_old_chains.size(); i++)
+					{
+						this->migrate_chain(this->m_migrated++);
+					}
+
+					if (this->m_migrated == this->m_old_chains.size())
+					{
+						std::vector<node*>().swap(this->m_old_chains);
+						this->m_migrated = 0;
+					}
+				}
+
+				void start_resize()
+				{
+					this->m_old_chains.swap(this->m_chains);
+					this->m_chains.assign(2 * this->m_old_chains.size(), nullptr);
+					this->m_migrated = 0;
+				}
+
+				void migrate_chain(std::size_t i)
+				{
+					node* item = this->m_old_chains[i];
+					this->m_old_chains[i] = nullptr;
+
+					while (item)
+					{
+						node* const next = item->m_next;
+						node*& chain = this->m_chains[item->m_hash % this->m_chains.size()];
+
+						item->m_next = chain;
+						chain = item;
+
+						item = next;
+					}
+				}
+
+				static node* find_node(const std::vector<node*>& chains, const _Key& key, std::size_t hash)
+				{
+					for (node* item = chains[hash % chains.size()]; item; item = item->m_next)
+					{
+						if (item->m_hash == hash && item->m_item.first == key)
+							return item;
+					}
+
+					return nullptr;
+				}
+
+				template<typename _Fn> static void for_each_node(const std::vector<node*>& chains, _Fn& fn)
+				{
+					for (const node* chain : chains)
+					{
+						for (const node* item = chain; item; item = item->m_next)
+						{
+							fn(item->m_item);
+						}
+					}
+				}
+
+				static void delete_chains(std::vector<node*>& chains)
+				{
+					for (node*& chain : chains)
+					{
+						while (chain)
+						{
+							node* const next = chain->m_next;
+							delete chain;
+
+							chain = next;
+						}
+					}
+				}
+
+				std::vector<node*> m_chains;
+				std::vector<node*> m_old_chains;
+				std::size_t        m_migrated;
+				std::size_t        m_size;
+		};
+};
+
+// Swiss-table layout: every slot has a control byte holding either a 7-bit tag of its hash or an empty or deleted mark.
+// The control bytes of 16 slots form a group that is matched against a tag with one SSE2 compare, and the entries
+// sit in a contiguous slot array, so a lookup reads one control group and usually a single slot.
+class flat_storage
+{
+	public:
+		template<typename _Key, typename _Val, typename _Hash> class table
+		{
+			static constexpr std::size_t group_size     = 16;
+			static constexpr std::size_t initial_groups = 1;
+			static constexpr std::size_t migration_step = 4;
+			static constexpr std::size_t not_found      = ~static_cast<std::size_t>(0);
+
+			// both marks have the sign bit set, tags of full slots never do
+			static constexpr signed char empty   = -128;
+			static constexpr signed char deleted = -2;
+
+			using value_type = std::pair<_Key, _Val>;
+
+			class alignas(group_size) control_group
+			{
+				public:
+					signed char m_bytes[group_size];
+			};
+
+			// raw storage, the entry is constructed only while the slot is full
+			union slot
+			{
+				slot()
+				{
+				}
+
+				~slot()
+				{
+				}
+
+				value_type m_item;
+			};
+
+			class array
+			{
+				public:
+					array(std::size_t groups)
+						: m_control{ new control_group[groups] }, m_slots{ new slot[groups * group_size] }, m_mask{ groups - 1 }, m_used{ 0 }
+					{
+						for (std::size_t i = 0; i < groups; i++)
+						{
+							std::fill(this->m_control[i].m_bytes, this->m_control[i].m_bytes + group_size, empty);
+						}
+					}
+
+					std::size_t capacity() const
+					{
+						return (this->m_mask + 1) * group_size;
+					}
+
+					std::unique_ptr<control_group[]> m_control;
+					std::unique_ptr<slot[]>          m_slots;
+					std::size_t                      m_mask;
+					std::size_t                      m_used; // full and deleted slots
+			};
+
+			public:
+				// trivially copyable entries may be read without the lock, by copying them out and checking that no writer
+				// ran meanwhile. Such a reader can still be probing an array the table has moved away from, so in that case
+				// drained arrays are kept until the table is destroyed
+				static constexpr bool optimistic_reads = std::is_trivially_copyable<_Key>::value && std::is_trivially_copyable<_Val>::value;
+
+				table(const _Hash& hasher)
+					: m_hasher{ hasher }, m_array{ new array(initial_groups) }, m_old_array{ nullptr }, m_migrated{ 0 }, m_size{ 0 }
+				{
+				}
+
+				~table()
+				{
+					table::delete_array(this->m_array.load());
+					table::delete_array(this->m_old_array.load());
+
+					for (array* items : this->m_retired_arrays)
+					{
+						table::delete_array(items);
+					}
+				}
+
+				table(const table&) = delete;
+				table& operator=(const table&) = delete;
+
+				const _Val* find(const _Key& key, std::size_t hash) const
+				{
+					using namespace std;
+
+					hash = table::mix(hash);
+
+					// during a resize the key is either still in the old array or already in the new one
+					if (const array* const old_items = this->m_old_array.load(memory_order_acquire))
+					{
+						const size_t i = table::find_index(*old_items, key, hash);
+
+						if (i != not_found)
+							return &old_items->m_slots[i].m_item.second;
+					}
+
+					const array* const items = this->m_array.load(memory_order_acquire);
+					const size_t i = table::find_index(*items, key, hash);
+
+					return i != not_found ? &items->m_slots[i].m_item.second : nullptr;
+				}
+
+				bool insert_or_assign(const _Key& key, std::size_t hash, const _Val& value)
+				{
+					using namespace std;
+
+					hash = table::mix(hash);
+					this->prepare_write(key, hash);
+
+					array* items = this->m_array.load(memory_order_relaxed);
+					const size_t i = table::find_index(*items, key, hash);
+
+					if (i != not_found)
+					{
+						items->m_slots[i].m_item.second = value;
+						return false;
+					}
+
+					// grows at a load of 7/8, counting deleted slots since they lengthen the probes as well
+					if (!this->m_old_array.load(memory_order_relaxed) && 8 * (items->m_used + 1) > 7 * items->capacity())
+					{
+						items = this->start_resize();
+					}
+
+					table::emplace(*items, hash, key, value);
+					++this->m_size;
+
+					return true;
+				}
+
+				bool erase(const _Key& key, std::size_t hash)
+				{
+					using namespace std;
+
+					hash = table::mix(hash);
+					this->prepare_write(key, hash);
+
+					array* const items = this->m_array.load(memory_order_relaxed);
+					const size_t i = table::find_index(*items, key, hash);
+
+					if (i == not_found)
+						return false;
+
+					table::erase_index(*items, i);
+					--this->m_size;
+
+					return true;
+				}
+
+				template<typename _Fn> void for_each(_Fn fn) const
+				{
+					using namespace std;
+
+					table::for_each_item(this->m_old_array.load(memory_order_relaxed), fn);
+					table::for_each_item(this->m_array.load(memory_order_relaxed), fn);
+				}
+
+				// keeps the capacity the table has grown to
+				int clear()
+				{
+					using namespace std;
+
+					const int res = static_cast<int>(this->m_size);
+
+					table::destroy_items(this->m_array.load(memory_order_relaxed));
+					this->retire_array(this->m_old_array.exchange(nullptr, memory_order_relaxed));
+
+					this->m_migrated = 0;
+					this->m_size = 0;
+
+					return res;
+				}
+
+			private:
+				// the key moves out of the old array first, so the write below only has to look at the new one
+				void prepare_write(const _Key& key, std::size_t hash)
+				{
+					using namespace std;
+
+					array* const old_items = this->m_old_array.load(memory_order_relaxed);
+
+					if (!old_items)
+						return;
+
+					const size_t i = table::find_index(*old_items, key, hash);
+
+					if (i != not_found)
+					{
+						this->move_item(*old_items, i, hash);
+					}
+
+					for (size_t j = 0; j < migration_step && this->m_migrated <= old_items->m_mask; j++)
+					{
+						this->migrate_group(*old_items, this->m_migrated++);
+					}
+
+					if (this->m_migrated > old_items->m_mask)
+					{
+						this->m_old_array.store(nullptr, memory_order_relaxed);
+						this->retire_array(old_items);
+
+						this->m_migrated = 0;
+					}
+				}
+
+				// a table that is mostly tombstones is rebuilt at the same size.
+				// Either way the new array has room for the writes that happen until the old one is drained.
+				// The old array is published first, so a reader never finds the table without the current one
+				array* start_resize()
+				{
+					using namespace std;
+
+					array* const old_items = this->m_array.load(memory_order_relaxed);
+
+					const size_t groups = old_items->m_mask + 1;
+					const bool grow = 16 * this->m_size > 7 * old_items->capacity();
+
+					array* const items = new array(grow ? 2 * groups : groups);
+
+					this->m_old_array.store(old_items, memory_order_relaxed);
+					this->m_array.store(items, memory_order_release);
+					this->m_migrated = 0;
+
+					return items;
+				}
+
+				void migrate_group(array& old_items, std::size_t group)
+				{
+					for (std::size_t i = group * group_size; i < (group + 1) * group_size; i++)
+					{
+						if (table::control(old_items, i) >= 0)
+						{
+							this->move_item(old_items, i, table::mix(this->m_hasher(old_items.m_slots[i].m_item.first)));
+						}
+					}
+				}
+
+				// the old array is never written to again, so the slot becomes a tombstone that keeps its probes going
+				void move_item(array& old_items, std::size_t i, std::size_t hash)
+				{
+					using namespace std;
+
+					value_type& item = old_items.m_slots[i].m_item;
+
+					table::emplace(*this->m_array.load(memory_order_relaxed), hash, move(item));
+					item.~value_type();
+
+					table::set_control(old_items, i, deleted);
+				}
+
+				void retire_array(array* items)
+				{
+					if (!items)
+						return;
+
+					if constexpr (optimistic_reads)
+					{
+						this->m_retired_arrays.push_back(items);
+					}
+					else
+					{
+						table::delete_array(items);
+					}
+				}
+
+				// groups are probed at triangular offsets, which visit every group of a power-of-two array.
+				// A group with an empty slot ends the probe: an insert never passes a group that has one
+				static std::size_t find_index(const array& items, const _Key& key, std::size_t hash)
+				{
+					const signed char tag = table::get_tag(hash);
+					std::size_t group = (hash >> 7) & items.m_mask;
+
+					// after m_mask + 1 steps every group has been seen, only an optimistic reader that caught the
+					// control bytes in the middle of a write can get that far
+					for (std::size_t step = 1; step <= items.m_mask + 1; step++)
+					{
+						const signed char* const bytes = items.m_control[group].m_bytes;
+
+						for (unsigned int found = table::match(bytes, tag); found; found &= found - 1)
+						{
+							const std::size_t i = group * group_size + table::lowest_bit(found);
+
+							if (items.m_slots[i].m_item.first == key)
+								return i;
+						}
+
+						if (table::match(bytes, empty))
+							return not_found;
+
+						group = (group + step) & items.m_mask;
+					}
+
+					return not_found;
+				}
+
+				template<typename... _Args> static void emplace(array& items, std::size_t hash, _Args&&... args)
+				{
+					std::size_t group = (hash >> 7) & items.m_mask;
+
+					for (std::size_t step = 1; ; step++)
+					{
+						if (const unsigned int available = table::match_free(items.m_control[group].m_bytes))
+						{
+							const std::size_t i = group * group_size + table::lowest_bit(available);
+
+							if (table::control(items, i) == empty)
+							{
+								++items.m_used;
+							}
+
+							new (&items.m_slots[i].m_item) value_type(std::forward<_Args>(args)...);
+							table::set_control(items, i, table::get_tag(hash));
+
+							return;
+						}
+
+						group = (group + step) & items.m_mask;
+					}
+				}
+
+				// a slot may only become empty again if its group already has an empty one, otherwise a probe
+				// that went through the group to a later one would stop short
+				static void erase_index(array& items, std::size_t i)
+				{
+					items.m_slots[i].m_item.~value_type();
+
+					if (table::match(items.m_control[i / group_size].m_bytes, empty))
+					{
+						table::set_control(items, i, empty);
+						--items.m_used;
+					}
+					else
+					{
+						table::set_control(items, i, deleted);
+					}
+				}
+
+				template<typename _Fn> static void for_each_item(const array* items, _Fn& fn)
+				{
+					if (!items)
+						return;
+
+					for (std::size_t i = 0; i < items->capacity(); i++)
+					{
+						if (table::control(*items, i) >= 0)
+						{
+							fn(items->m_slots[i].m_item);
+						}
+					}
+				}
+
+				// leaves every slot empty, tombstones included
+				static void destroy_items(array* items)
+				{
+					for (std::size_t i = 0; i < items->capacity(); i++)
+					{
+						if (table::control(*items, i) >= 0)
+						{
+							items->m_slots[i].m_item.~value_type();
+						}
+
+						table::set_control(*items, i, empty);
+					}
+
+					items->m_used = 0;
+				}
+
+				static void delete_array(array* items)
+				{
+					if (!items)
+						return;
+
+					table::destroy_items(items);
+					delete items;
+				}
+
+				static signed char control(const array& items, std::size_t i)
+				{
+					return items.m_control[i / group_size].m_bytes[i % group_size];
+				}
+
+				static void set_control(array& items, std::size_t i, signed char byte)
+				{
+					items.m_control[i / group_size].m_bytes[i % group_size] = byte;
+				}
+
+				// the caller's hash may have weak bits (std::hash of an integer is the integer itself),
+				// the group index and the tag both need well mixed ones
+				static std::size_t mix(std::size_t hash)
+				{
+					if constexpr (sizeof(std::size_t) == 8)
+					{
+						hash ^= hash >> 33;
+						hash *= static_cast<std::size_t>(0xff51afd7ed558ccdull);
+						hash ^= hash >> 33;
+					}
+					else
+					{
+						hash ^= hash >> 16;
+						hash *= static_cast<std::size_t>(0x85ebca6bu);
+						hash ^= hash >> 13;
+					}
+
+					return hash;
+				}
+
+				static signed char get_tag(std::size_t hash)
+				{
+					return static_cast<signed char>(hash & 0x7F);
+				}
+
+				static std::size_t lowest_bit(unsigned int mask)
+				{
+#if defined(_MSC_VER)
+					unsigned long i = 0;
+					_BitScanForward(&i, mask);
+
+					return i;
+#else
+					return static_cast<std::size_t>(__builtin_ctz(mask));
+#endif
+				}
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+				// one bit per slot of the group whose control byte equals byte
+				static unsigned int match(const signed char* bytes, signed char byte)
+				{
+					const __m128i group = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+					return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte))));
+				}
+
+				// one bit per empty or deleted slot, the sign bits are exactly what movemask collects
+				static unsigned int match_free(const signed char* bytes)
+				{
+					return static_cast<unsigned int>(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(bytes))));
+				}
+#else
+				static unsigned int match(const signed char* bytes, signed char byte)
+				{
+					unsigned int res = 0;
+
+					for (std::size_t i = 0; i < group_size; i++)
+					{
+						res |= static_cast<unsigned int>(bytes[i] == byte) << i;
+					}
+
+					return res;
+				}
+
+				static unsigned int match_free(const signed char* bytes)
+				{
+					unsigned int res = 0;
+
+					for (std::size_t i = 0; i < group_size; i++)
+					{
+						res |= static_cast<unsigned int>(bytes[i] < 0) << i;
+					}
+
+					return res;
+				}
+#endif
+
+				const _Hash&        m_hasher;
+				std::atomic<array*> m_array;
+				std::atomic<array*> m_old_array;
+				std::vector<array*> m_retired_arrays;
+				std::size_t         m_migrated;
+				std::size_t         m_size;
+		};
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+
+#include "hazard_pointer_domain.h"
+#include "epoch_domain.h"
+#include "backoff.h"
+
+// _Backoff paces the CAS that pushes to the shared retired list
+template<typename _Backoff = no_backoff> class pop_count_reclaimer
+{
+	public:
+		class node_base
+		{
+			public:
+				node_base()
+					: m_deleter{ nullptr }, m_retired_next{ nullptr }
+				{
+				}
+
+				void       (*m_deleter)(node_base*);
+				node_base* m_retired_next;
+		};
+
+		class guard
+		{
+			public:
+				guard(pop_count_reclaimer& reclaimer)
+					: m_reclaimer{ reclaimer }
+				{
+					this->m_reclaimer.m_active.fetch_add(1);
+				}
+
+				~guard()
+				{
+					this->m_reclaimer.leave();
+				}
+
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+
+				template<typename _Tx> _Tx* protect(int, const std::atomic<_Tx*>& src)
+				{
+					return src.load();
+				}
+
+				template<typename _Tx> void retire(_Tx* item)
+				{
+					item->m_deleter = [](node_base* data)->void { delete static_cast<_Tx*>(data); };
+					this->m_reclaimer.add_pending(item, item);
+				}
+
+			private:
+				pop_count_reclaimer& m_reclaimer;
+		};
+
+		pop_count_reclaimer()
+			: m_pending{ nullptr }, m_active{ 0 }
+		{
+		}
+
+		~pop_count_reclaimer()
+		{
+			pop_count_reclaimer::delete_nodes(this->m_pending.exchange(nullptr));
+		}
+
+		pop_count_reclaimer(const pop_count_reclaimer&) = delete;
+		pop_count_reclaimer& operator=(const pop_count_reclaimer&) = delete;
+
+	private:
+		void leave()
+		{
+			if (this->m_active.load() == 1)
+			{
+				node_base* nodes = this->m_pending.exchange(nullptr);
+
+				// nobody entered after the exchange, so no thread can still hold one of the claimed nodes
+				if (this->m_active.load() == 1)
+				{
+					pop_count_reclaimer::delete_nodes(nodes);
+				}
+				else if (nodes)
+				{
+					node_base* tail = nodes;
+
+					while (tail->m_retired_next)
+					{
+						tail = tail->m_retired_next;
+					}
+
+					this->add_pending(nodes, tail);
+				}
+			}
+
+			this->m_active.fetch_sub(1);
+		}
+
+		void add_pending(node_base* head, node_base* tail)
+		{
+			_Backoff backoff;
+
+			tail->m_retired_next = this->m_pending.load();
+
+			while (!this->m_pending.compare_exchange_weak(tail->m_retired_next, head))
+				backoff();
+		}
+
+		static void delete_nodes(node_base* nodes)
+		{
+			while (nodes)
+			{
+				node_base* const next = nodes->m_retired_next;
+				nodes->m_deleter(nodes);
+
+				nodes = next;
+			}
+		}
+
+		std::atomic<node_base*> m_pending;
+		std::atomic<int>        m_active;
+};
+
+class hazard_pointer_reclaimer
+{
+	using domain = hazard_pointer_domain<2>;
+
+	public:
+		using node_base = hazard_retire_record;
+
+		class guard
+		{
+			public:
+				guard(hazard_pointer_reclaimer& reclaimer)
+					: m_domain{ reclaimer.m_domain }
+				{
+				}
+
+				~guard()
+				{
+					this->m_domain.clear(0);
+					this->m_domain.clear(1);
+				}
+
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+
+				template<typename _Tx> _Tx* protect(int i, const std::atomic<_Tx*>& src)
+				{
+					return this->m_domain.protect(i, src);
+				}
+
+				template<typename _Tx> void retire(_Tx* item)
+				{
+					this->m_domain.retire(item);
+				}
+
+			private:
+				domain& m_domain;
+		};
+
+	private:
+		domain m_domain;
+};
+
+class epoch_reclaimer
+{
+	using domain = epoch_domain<>;
+
+	public:
+		using node_base = epoch_retire_record;
+
+		class guard
+		{
+			public:
+				guard(epoch_reclaimer& reclaimer)
+					: m_guard{ reclaimer.m_domain }
+				{
+				}
+
+				template<typename _Tx> _Tx* protect(int, const std::atomic<_Tx*>& src)
+				{
+					return src.load();
+				}
+
+				template<typename _Tx> void retire(_Tx* item)
+				{
+					this->m_guard.retire(item);
+				}
+
+			private:
+				domain::guard m_guard;
+		};
+
+	private:
+		domain m_domain;
+};
+
+// frees nothing while the container lives, the baseline for measuring what reclamation costs
+template<typename _Backoff = no_backoff> class leak_reclaimer
+{
+	public:
+		class node_base
+		{
+			public:
+				node_base()
+					: m_deleter{ nullptr }, m_retired_next{ nullptr }
+				{
+				}
+
+				void       (*m_deleter)(node_base*);
+				node_base* m_retired_next;
+		};
+
+		class guard
+		{
+			public:
+				guard(leak_reclaimer& reclaimer)
+					: m_reclaimer{ reclaimer }
+				{
+				}
+
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+
+				template<typename _Tx> _Tx* protect(int, const std::atomic<_Tx*>& src)
+				{
+					return src.load();
+				}
+
+				template<typename _Tx> void retire(_Tx* item)
+				{
+					_Backoff backoff;
+
+					item->m_deleter = [](node_base* data)->void { delete static_cast<_Tx*>(data); };
+					item->m_retired_next = this->m_reclaimer.m_retired.load();
+
+					while (!this->m_reclaimer.m_retired.compare_exchange_weak(item->m_retired_next, item))
+						backoff();
+				}
+
+			private:
+				leak_reclaimer& m_reclaimer;
+		};
+
+		leak_reclaimer()
+			: m_retired{ nullptr }
+		{
+		}
+
+		~leak_reclaimer()
+		{
+			node_base* nodes = this->m_retired.exchange(nullptr);
+
+			while (nodes)
+			{
+				node_base* const next = nodes->m_retired_next;
+				nodes->m_deleter(nodes);
+
+				nodes = next;
+			}
+		}
+
+		leak_reclaimer(const leak_reclaimer&) = delete;
+		leak_reclaimer& operator=(const leak_reclaimer&) = delete;
+
+	private:
+		std::atomic<node_base*> m_retired;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// A pointer and a counter packed into one 64-bit word, so std::atomic<tagged_ptr> is a plain 8-byte CAS.
+// User-space pointers on x86-64 and AArch64 fit into 48 bits, which leaves 16 bits for the counter;
+// on 32-bit targets the counter gets the whole upper half.
+template<typename _Ty> class tagged_ptr
+{
+	static constexpr int           pointer_bits = sizeof(void*) == 8 ? 48 : 32;
+	static constexpr std::uint64_t pointer_mask = (std::uint64_t(1) << pointer_bits) - 1;
+
+	public:
+		static constexpr unsigned max_tag = static_cast<unsigned>((~std::uint64_t(0)) >> pointer_bits);
+
+		tagged_ptr() noexcept
+			: m_value{ 0 }
+		{
+		}
+
+		tagged_ptr(_Ty* ptr, unsigned tag) noexcept
+			: m_value{ (static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ptr)) & pointer_mask) |
+				(static_cast<std::uint64_t>(tag) << pointer_bits) }
+		{
+		}
+
+		_Ty* get_ptr() const noexcept
+		{
+			return reinterpret_cast<_Ty*>(static_cast<std::uintptr_t>(this->m_value & pointer_mask));
+		}
+
+		unsigned get_tag() const noexcept
+		{
+			return static_cast<unsigned>(this->m_value >> pointer_bits);
+		}
+
+		bool operator==(const tagged_ptr& other) const noexcept
+		{
+			return this->m_value == other.m_value;
+		}
+
+		bool operator!=(const tagged_ptr& other) const noexcept
+		{
+			return this->m_value != other.m_value;
+		}
+
+	private:
+		std::uint64_t m_value;
+};
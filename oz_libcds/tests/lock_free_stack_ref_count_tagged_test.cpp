@@ -0,0 +1,103 @@
+// Drives one node of lock_free_stack_ref_count_tagged through more lost pops than the 16-bit tag can count.
+// g++ -std=c++17 -O1 -g -fsanitize=address -pthread -I.. lock_free_stack_ref_count_tagged_test.cpp
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#define private public
+#include "lock_free_stack_ref_count_tagged.h"
+#undef private
+
+using stack_type = lock_free_stack_ref_count_tagged<int>;
+
+// A popper raises the head's count and then loses the node to a push, so it gives its count back to the node
+// while its increment stays in the tag saved in the pushed node. Popping the pushed node brings that tag back.
+bool check_lost_pops(int lost_pops)
+{
+	stack_type stack;
+	bool res = false;
+
+	stack.push(-1, res);
+
+	for (int i = 0; i < lost_pops; i++)
+	{
+		auto head = stack.m_head.load();
+		stack.increase_head_count(head);
+
+		stack.push(i, res);
+		stack_type::release_count(head.get_ptr());
+
+		const std::shared_ptr<int> value = stack.pop();
+
+		if (!value || *value != i)
+		{
+			printf("lost pop %d: popped the wrong value\n", i);
+			return false;
+		}
+
+		// no borrower is left, so the counts in the tag and the node must cancel out
+		head = stack.m_head.load();
+		const int internal = head.get_ptr()->m_internal_counter.load();
+
+		if (head.get_tag() > stack_type::fold_threshold || internal != stack_type::unpopped_bias - static_cast<int>(head.get_tag() - 1))
+		{
+			printf("lost pop %d: tag %u, internal counter %d\n", i, head.get_tag(), internal);
+			return false;
+		}
+	}
+
+	const std::shared_ptr<int> value = stack.pop();
+
+	return value && *value == -1 && !stack.pop();
+}
+
+bool check_threads(int threads, int items_per_thread)
+{
+	stack_type stack;
+	std::atomic<long long> checksum{ 0 };
+	std::vector<std::thread> workers;
+
+	for (int i = 0; i < threads; i++)
+	{
+		workers.push_back(std::thread([&]()->void
+		{
+			long long sum = 0;
+
+			for (int j = 1; j <= items_per_thread; j++)
+			{
+				bool res = false;
+				stack.push(j, res);
+
+				if (const std::shared_ptr<int> value = stack.pop())
+				{
+					sum += *value;
+				}
+			}
+
+			checksum.fetch_add(sum);
+		}));
+	}
+
+	for (auto& th : workers)
+	{
+		th.join();
+	}
+
+	while (const std::shared_ptr<int> value = stack.pop())
+	{
+		checksum.fetch_add(*value);
+	}
+
+	return checksum.load() == static_cast<long long>(threads) * items_per_thread * (items_per_thread + 1) / 2;
+}
+
+int main()
+{
+	const bool lost_pops = check_lost_pops(3 * (stack_type::counted_node_ptr::max_tag + 1) / 2);
+	const bool threads = check_threads(4, 100000);
+
+	printf("lost pops: %s\nthreads:   %s\n", lost_pops ? "ok" : "failed", threads ? "ok" : "failed");
+
+	return lost_pops && threads ? 0 : 1;
+}
@@ -0,0 +1,584 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+#include <initializer_list>
+
+#include "hazard_pointer_domain.h"
+#include "backoff.h"
+
+// _Backoff only paces the bounded fast path, the announced slow path keeps its wait-free helping
+template<typename _Ty, int max_threads = 128, typename _Backoff = no_backoff> class wait_free_queue
+{
+	static constexpr int max_failures   = 16;
+	static constexpr int helping_delay  = 32;
+	static constexpr int fast_tid       = -2;
+
+	static constexpr int hp_head = 0;
+	static constexpr int hp_tail = 1;
+	static constexpr int hp_next = 2;
+	static constexpr int hp_desc = 3;
+
+	class node : public hazard_retire_record
+	{
+		public:
+			node()
+				: m_next{ nullptr }, m_enq_tid{ -1 }, m_deq_tid{ -1 }, m_claims{ 1 }
+			{
+			}
+
+			node(const _Ty& data)
+				: m_data{ data }, m_next{ nullptr }, m_enq_tid{ -1 }, m_deq_tid{ -1 }, m_claims{ 2 }
+			{
+			}
+
+			std::optional<_Ty> m_data;
+			std::atomic<node*> m_next;
+			int                m_enq_tid;
+			std::atomic<int>   m_deq_tid;
+			std::atomic<int>   m_claims;
+	};
+
+	class op_desc : public hazard_retire_record
+	{
+		public:
+			op_desc(long long phase, bool is_pending, bool is_enqueue, node* item)
+				: m_phase{ phase }, m_is_pending{ is_pending }, m_is_enqueue{ is_enqueue }, m_node{ item }
+			{
+			}
+
+			const long long m_phase;
+			const bool      m_is_pending;
+			const bool      m_is_enqueue;
+			node* const     m_node;
+	};
+
+	class thread_slot
+	{
+		public:
+			thread_slot(std::atomic<bool>(&slots)[max_threads])
+				: m_slot{ nullptr }, m_index{ -1 }
+			{
+				using namespace std;
+
+				for (int i = 0; i < max_threads; i++)
+				{
+					bool is_used = false;
+
+					if (slots[i].compare_exchange_strong(is_used, true))
+					{
+						this->m_slot = &slots[i];
+						this->m_index = i;
+						break;
+					}
+				}
+
+				if (!this->m_slot)
+				{
+					throw runtime_error("No wait-free queue thread slots available");
+				}
+			}
+
+			~thread_slot()
+			{
+				this->m_slot->store(false);
+			}
+
+			thread_slot(const thread_slot&) = delete;
+			thread_slot& operator=(const thread_slot&) = delete;
+
+			std::atomic<bool>* m_slot;
+			int                m_index;
+	};
+
+	class alignas(64) helping_record
+	{
+		public:
+			helping_record()
+				: m_counter{ 0 }, m_next_tid{ 0 }
+			{
+			}
+
+			int m_counter;
+			int m_next_tid;
+	};
+
+	using domain = hazard_pointer_domain<4>;
+
+	public:
+		// every thread that touches a queue of this type holds one of the slots until it exits
+		static constexpr int max_num_of_threads = max_threads;
+
+		static constexpr bool is_always_lock_free =
+			std::atomic<node*>::is_always_lock_free &&
+			std::atomic<op_desc*>::is_always_lock_free &&
+			std::atomic<long long>::is_always_lock_free &&
+			std::atomic<int>::is_always_lock_free &&
+			std::atomic<bool>::is_always_lock_free;
+
+		wait_free_queue()
+			: m_head{ new node }, m_phase{ 0 }, m_is_active{ true }
+		{
+			this->m_tail.store(this->m_head.load());
+
+			for (int i = 0; i < max_threads; i++)
+			{
+				this->m_state[i].store(new op_desc(-1, false, true, nullptr));
+			}
+		}
+
+		wait_free_queue(std::initializer_list<_Ty>& init_list)
+			: wait_free_queue()
+		{
+			using namespace std;
+
+			auto it = init_list.begin();
+
+			while (it != init_list.end())
+			{
+				this->push_item(*it);
+				++it;
+			}
+		}
+
+		~wait_free_queue()
+		{
+			this->m_is_active = false;
+
+			node* item = this->m_head.load();
+
+			while (item)
+			{
+				node* const next = item->m_next.load();
+				delete item;
+
+				item = next;
+			}
+
+			for (int i = 0; i < max_threads; i++)
+			{
+				delete this->m_state[i].load();
+			}
+		}
+
+		wait_free_queue(const wait_free_queue&) = delete;
+		wait_free_queue& operator=(const wait_free_queue&) = delete;
+
+		void push(const _Ty& data, bool& res)
+		{
+			if (this->m_is_active)
+			{
+				this->push_item(data);
+				res = true;
+
+				return;
+			}
+
+			res = false;
+		}
+
+		bool try_pop(_Ty& res)
+		{
+			return this->m_is_active && this->pop_item(res);
+		}
+
+		std::shared_ptr<_Ty> pop()
+		{
+			using namespace std;
+
+			_Ty res;
+
+			if (this->try_pop(res))
+			{
+				return make_shared<_Ty>(move(res));
+			}
+
+			return shared_ptr<_Ty>();
+		}
+
+		int clear()
+		{
+			int j = 0;
+			_Ty item;
+
+			while (this->try_pop(item))
+			{
+				++j;
+			}
+
+			return j;
+		}
+
+		bool is_active() const
+		{
+			return this->m_is_active;
+		}
+
+	private:
+		static std::atomic<bool>(&get_thread_slots())[max_threads]
+		{
+			static std::atomic<bool> slots[max_threads];
+			return slots;
+		}
+
+		static int get_thread_id()
+		{
+			thread_local static thread_slot slot(wait_free_queue::get_thread_slots());
+			return slot.m_index;
+		}
+
+		static void clear_hazards(domain& hazards)
+		{
+			hazards.clear(hp_head);
+			hazards.clear(hp_tail);
+			hazards.clear(hp_next);
+			hazards.clear(hp_desc);
+		}
+
+		void push_item(const _Ty& data)
+		{
+			domain& hazards = this->m_domain;
+
+			const int tid = wait_free_queue::get_thread_id();
+			this->help_if_needed(tid);
+
+			node* const item = new node(data);
+			_Backoff backoff;
+
+			for (int i = 0; i < max_failures; i++)
+			{
+				node* last = hazards.protect(hp_tail, this->m_tail);
+				node* next = hazards.protect(hp_next, last->m_next);
+
+				if (last != this->m_tail.load())
+					continue;
+
+				if (next)
+				{
+					this->help_finish_enq();
+					continue;
+				}
+
+				if (last->m_next.compare_exchange_strong(next, item))
+				{
+					this->m_tail.compare_exchange_strong(last, item);
+					wait_free_queue::clear_hazards(hazards);
+
+					return;
+				}
+
+				backoff();
+			}
+
+			item->m_enq_tid = tid;
+
+			const long long phase = this->m_phase.fetch_add(1) + 1;
+			this->announce(tid, new op_desc(phase, true, true, item));
+
+			this->help(phase);
+			this->help_finish_enq();
+
+			wait_free_queue::clear_hazards(hazards);
+		}
+
+		bool pop_item(_Ty& res)
+		{
+			domain& hazards = this->m_domain;
+
+			const int tid = wait_free_queue::get_thread_id();
+			this->help_if_needed(tid);
+
+			_Backoff backoff;
+
+			for (int i = 0; i < max_failures; i++)
+			{
+				node* first = hazards.protect(hp_head, this->m_head);
+				node* last  = hazards.protect(hp_tail, this->m_tail);
+				node* next  = hazards.protect(hp_next, first->m_next);
+
+				if (first != this->m_head.load())
+					continue;
+
+				if (first == last)
+				{
+					if (!next)
+					{
+						wait_free_queue::clear_hazards(hazards);
+						return false;
+					}
+
+					this->help_finish_enq();
+					continue;
+				}
+
+				int deq_tid = -1;
+
+				if (first->m_deq_tid.compare_exchange_strong(deq_tid, fast_tid))
+				{
+					node* head = first;
+					this->m_head.compare_exchange_strong(head, next);
+
+					this->take_value(first, next, res);
+
+					return true;
+				}
+
+				this->help_finish_deq();
+				backoff();
+			}
+
+			const long long phase = this->m_phase.fetch_add(1) + 1;
+			this->announce(tid, new op_desc(phase, true, false, nullptr));
+
+			this->help(phase);
+			this->help_finish_deq();
+
+			node* const first = hazards.protect(hp_desc, this->m_state[tid])->m_node;
+
+			if (!first)
+			{
+				wait_free_queue::clear_hazards(hazards);
+				return false;
+			}
+
+			this->take_value(first, first->m_next.load(), res);
+
+			return true;
+		}
+
+		void take_value(node* first, node* next, _Ty& res)
+		{
+			using namespace std;
+
+			domain& hazards = this->m_domain;
+
+			res = move(*next->m_data);
+			next->m_data.reset();
+
+			wait_free_queue::clear_hazards(hazards);
+
+			this->release_claim(next);
+			this->release_claim(first);
+		}
+
+		void release_claim(node* item)
+		{
+			if (item->m_claims.fetch_sub(1) == 1)
+			{
+				this->m_domain.retire(item);
+			}
+		}
+
+		void announce(int tid, op_desc* desc)
+		{
+			op_desc* const old_desc = this->m_state[tid].exchange(desc);
+			this->m_domain.retire(old_desc);
+		}
+
+		bool replace_desc(int tid, op_desc* cur_desc, op_desc* desc)
+		{
+			if (this->m_state[tid].compare_exchange_strong(cur_desc, desc))
+			{
+				this->m_domain.retire(cur_desc);
+				return true;
+			}
+
+			delete desc;
+			return false;
+		}
+
+		bool is_still_pending(int tid, long long phase)
+		{
+			op_desc* const desc = this->m_domain.protect(hp_desc, this->m_state[tid]);
+			return desc->m_is_pending && desc->m_phase <= phase;
+		}
+
+		void help_if_needed(int tid)
+		{
+			helping_record& record = this->m_helping[tid];
+
+			if (++record.m_counter < helping_delay)
+				return;
+
+			record.m_counter = 0;
+
+			const int help_tid = record.m_next_tid;
+			record.m_next_tid = (help_tid + 1) % max_threads;
+
+			op_desc* const desc = this->m_domain.protect(hp_desc, this->m_state[help_tid]);
+
+			if (desc->m_is_pending)
+			{
+				if (desc->m_is_enqueue)
+				{
+					this->help_enq(help_tid, desc->m_phase);
+				}
+				else
+				{
+					this->help_deq(help_tid, desc->m_phase);
+				}
+			}
+		}
+
+		void help(long long phase)
+		{
+			domain& hazards = this->m_domain;
+
+			for (int i = 0; i < max_threads; i++)
+			{
+				op_desc* const desc = hazards.protect(hp_desc, this->m_state[i]);
+
+				if (desc->m_is_pending && desc->m_phase <= phase)
+				{
+					if (desc->m_is_enqueue)
+					{
+						this->help_enq(i, phase);
+					}
+					else
+					{
+						this->help_deq(i, phase);
+					}
+				}
+			}
+		}
+
+		void help_enq(int tid, long long phase)
+		{
+			domain& hazards = this->m_domain;
+
+			while (this->is_still_pending(tid, phase))
+			{
+				node* last = hazards.protect(hp_tail, this->m_tail);
+				node* next = hazards.protect(hp_next, last->m_next);
+
+				if (last != this->m_tail.load())
+					continue;
+
+				if (next)
+				{
+					this->help_finish_enq();
+					continue;
+				}
+
+				op_desc* const desc = hazards.protect(hp_desc, this->m_state[tid]);
+
+				if (!desc->m_is_pending || desc->m_phase > phase)
+					return;
+
+				if (last->m_next.compare_exchange_strong(next, desc->m_node))
+				{
+					this->help_finish_enq();
+					return;
+				}
+			}
+		}
+
+		void help_finish_enq()
+		{
+			domain& hazards = this->m_domain;
+
+			node* last = hazards.protect(hp_tail, this->m_tail);
+			node* const next = hazards.protect(hp_next, last->m_next);
+
+			if (!next || last != this->m_tail.load())
+				return;
+
+			const int tid = next->m_enq_tid;
+
+			if (tid >= 0)
+			{
+				op_desc* const cur_desc = hazards.protect(hp_desc, this->m_state[tid]);
+
+				if (last == this->m_tail.load() && cur_desc->m_node == next)
+				{
+					this->replace_desc(tid, cur_desc, new op_desc(cur_desc->m_phase, false, true, next));
+				}
+			}
+
+			this->m_tail.compare_exchange_strong(last, next);
+		}
+
+		void help_deq(int tid, long long phase)
+		{
+			domain& hazards = this->m_domain;
+
+			while (this->is_still_pending(tid, phase))
+			{
+				node* const first = hazards.protect(hp_head, this->m_head);
+				node* const last  = hazards.protect(hp_tail, this->m_tail);
+				node* const next  = hazards.protect(hp_next, first->m_next);
+
+				if (first != this->m_head.load())
+					continue;
+
+				if (first == last)
+				{
+					if (next)
+					{
+						this->help_finish_enq();
+						continue;
+					}
+
+					op_desc* const cur_desc = hazards.protect(hp_desc, this->m_state[tid]);
+
+					if (last == this->m_tail.load() && cur_desc->m_is_pending && cur_desc->m_phase <= phase)
+					{
+						this->replace_desc(tid, cur_desc, new op_desc(cur_desc->m_phase, false, false, nullptr));
+					}
+
+					continue;
+				}
+
+				op_desc* const cur_desc = hazards.protect(hp_desc, this->m_state[tid]);
+
+				if (!cur_desc->m_is_pending || cur_desc->m_phase > phase)
+					break;
+
+				if (first == this->m_head.load() && cur_desc->m_node != first)
+				{
+					if (!this->replace_desc(tid, cur_desc, new op_desc(cur_desc->m_phase, true, false, first)))
+						continue;
+				}
+
+				int deq_tid = -1;
+				first->m_deq_tid.compare_exchange_strong(deq_tid, tid);
+
+				this->help_finish_deq();
+			}
+		}
+
+		void help_finish_deq()
+		{
+			domain& hazards = this->m_domain;
+
+			node* first = hazards.protect(hp_head, this->m_head);
+			node* const next = first->m_next.load();
+			const int tid = first->m_deq_tid.load();
+
+			if (tid == -1 || !next)
+				return;
+
+			if (tid != fast_tid)
+			{
+				op_desc* const cur_desc = hazards.protect(hp_desc, this->m_state[tid]);
+
+				if (first != this->m_head.load())
+					return;
+
+				this->replace_desc(tid, cur_desc, new op_desc(cur_desc->m_phase, false, false, cur_desc->m_node));
+			}
+
+			this->m_head.compare_exchange_strong(first, next);
+		}
+
+		std::atomic<node*>     m_head;
+		std::atomic<node*>     m_tail;
+		std::atomic<op_desc*>  m_state[max_threads];
+		helping_record         m_helping[max_threads];
+		std::atomic<long long> m_phase;
+		domain                 m_domain;
+		std::atomic<bool>      m_is_active;
+};